@@ -0,0 +1,485 @@
+// Микробенчмарки этапов конвейера и сквозная пропускная способность.
+// Данные генерируются из фиксированного зерна, каждое измерение
+// повторяется несколько раз, в отчёт идёт медиана.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "encoder_session.h"
+#include "gf256_region.h"
+#include "image_writer.h"
+#include "qr_code.h"
+#include "qr_constexpr.h"
+#include "reed_solomon.h"
+
+// Закрытые этапы ReedSolomon и QRCode (объявлен другом обоих классов)
+struct PipelineStages {
+    using Segments = std::vector<qr_segment::Segment>;
+
+    static void get_code(const std::string& message, const Segments& segments,
+                         int version, qr_spec::EccLevel level, uint8_t* out) {
+        ReedSolomon::get_code(message, segments, version, level, out);
+    }
+    static size_t module_sequence(int version) {
+        return QRCode::generate_module_sequence(
+                   QRCode::get_template(version).reserved)
+            .size();
+    }
+    static void fill(int version, const uint8_t* codewords, size_t n,
+                     QRMatrix& out) {
+        const QRCode::Template& tmpl = QRCode::get_template(version);
+        out.copy_from(tmpl.patterns);
+        QRCode::fill_matrix_by_message(tmpl, codewords, n, out);
+    }
+    static int select_mask(int version, qr_spec::EccLevel level,
+                           const QRMatrix& unmasked) {
+        return QRCode::select_mask(QRCode::get_template(version), level,
+                                   unmasked);
+    }
+    static void apply_mask(int version, qr_spec::EccLevel level, int mask,
+                           QRMatrix& out) {
+        QRCode::apply_data_mask(QRCode::get_template(version), mask, out);
+        QRCode::apply_mask(level, mask, out);
+    }
+    static void spec_lines(int version, QRMatrix& out) {
+        out.reset(qr_spec::symbol_size(version));
+        QRCode::generate_spec_lines(version, out);
+    }
+};
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchOptions {
+    enum class Format { TEXT, CSV, JSON } format = Format::TEXT;
+    double min_time = 0.2;  // секунд на одно повторение
+    int repeats = 3;
+    std::string filter;
+    std::string output_dir = ".";
+    std::vector<size_t> sizes = {16, 128, 1024};
+    std::vector<size_t> e2e_sizes = {16, 64, 256, 1024, 2048};
+    std::vector<int> threads;
+    qr_spec::EccLevel level = qr_spec::EccLevel::M;
+};
+
+struct Result {
+    std::string name;
+    size_t payload = 0;
+    int version = 0;
+    int threads = 1;
+    uint64_t iterations = 0;
+    double ns_per_op = 0;
+    double ops_per_sec = 0;
+};
+
+// Не даёт компилятору выбросить вычисления
+std::atomic<uint64_t> sink{0};
+
+std::string make_payload(size_t size, uint32_t seed) {
+    static const char ALPHABET[] =
+        "abcdefghijklmnopqrstuvwxyz0123456789/.-_?=&";
+    std::mt19937 rng(seed);
+    std::string payload(size, '\0');
+    for (char& c : payload) c = ALPHABET[rng() % (sizeof(ALPHABET) - 1)];
+    return payload;
+}
+
+// Символ qr::make, построенный при компиляции, против ReedSolomon::encode
+// и QRCode::generate с той же маской
+void check_symbol(const char* text, const qr::Symbol& symbol) {
+    ReedSolomon solomon;
+    ReedSolomon::Code code = solomon.encode(text, symbol.level);
+    QRMatrix matrix;
+    QRCode().generate(code.data(), code.size(), matrix, symbol.level,
+                      symbol.mask);
+    if (matrix != symbol.matrix) {
+        throw std::runtime_error(
+            std::string("qr::make differs from runtime encoding for ") +
+            text);
+    }
+}
+
+// Перед замерами: один символ с выбором маски, один со смешанными
+// сегментами и заданной маской
+void check_constexpr() {
+    static constexpr char URL[] = "spotify.com";
+    static constexpr char MIXED[] = "ORDER 0123456789012345 for pickup";
+    static constexpr qr::Symbol URL_SYMBOL = qr::make(URL);
+    static constexpr qr::Symbol MIXED_SYMBOL =
+        qr::make(MIXED, qr::EccLevel::H, 5);
+    check_symbol(URL, URL_SYMBOL);
+    check_symbol(MIXED, MIXED_SYMBOL);
+}
+
+double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Одно повторение: пачки удваиваются, пока не пройдёт min_time
+double time_once(const std::function<void()>& op, double min_time,
+                 uint64_t& iterations) {
+    uint64_t batch = 1;
+    iterations = 0;
+    Clock::time_point start = Clock::now();
+    double elapsed = 0;
+    while (elapsed < min_time) {
+        for (uint64_t i = 0; i < batch; ++i) op();
+        iterations += batch;
+        elapsed = seconds_since(start);
+        if (batch < (uint64_t(1) << 20)) batch *= 2;
+    }
+    return elapsed * 1e9 / iterations;
+}
+
+Result measure(const BenchOptions& options, const std::string& name,
+               size_t payload, int version,
+               const std::function<void()>& op) {
+    op();  // прогрев кэшей и шаблона версии
+    std::vector<double> samples;
+    Result result;
+    for (int r = 0; r < options.repeats; ++r) {
+        uint64_t iterations = 0;
+        samples.push_back(time_once(op, options.min_time, iterations));
+        result.iterations += iterations;
+    }
+    std::sort(samples.begin(), samples.end());
+    result.name = name;
+    result.payload = payload;
+    result.version = version;
+    result.ns_per_op = samples[samples.size() / 2];
+    result.ops_per_sec = 1e9 / result.ns_per_op;
+    return result;
+}
+
+// Фильтр — префикс имени этапа
+bool selected(const BenchOptions& options, const std::string& name) {
+    return name.compare(0, options.filter.size(), options.filter) == 0;
+}
+
+// Портит каждый блок на четверть его ECC-байтов
+ReedSolomon::Code inject_errors(const ReedSolomon::Code& code,
+                                qr_spec::EccLevel level, uint32_t seed) {
+    int version = qr_spec::version_for_codewords(static_cast<int>(code.size()));
+    qr_spec::BlockLayout layout = qr_spec::block_layout(version, level);
+    std::mt19937 rng(seed);
+    ReedSolomon::Code corrupted = code;
+    for (int b = 0; b < layout.blocks; ++b) {
+        int length = layout.data_length(b) + layout.ecc;
+        for (int e = 0; e < layout.ecc / 4; ++e) {
+            int index = static_cast<int>(rng() % length);
+            int data_length = layout.data_length(b);
+            int pos = index < data_length
+                          ? layout.data_position(b, index)
+                          : layout.ecc_position(b, index - data_length);
+            corrupted[pos] ^= static_cast<uint8_t>(1 + rng() % 255);
+        }
+    }
+    return corrupted;
+}
+
+void run_stages(const BenchOptions& options, std::vector<Result>& results) {
+    ReedSolomon rs;
+    QRCode qr;
+    for (size_t size : options.sizes) {
+        std::string message = make_payload(size, static_cast<uint32_t>(size));
+        PipelineStages::Segments segments;
+        int version;
+        try {
+            version = ReedSolomon::choose_version(message, options.level,
+                                                  &segments);
+        } catch (const std::exception&) {
+            continue;  // не помещается на этом уровне
+        }
+        qr_spec::EccLevel level = options.level;
+        std::vector<uint8_t> data(qr_spec::data_codewords(version, level));
+        PipelineStages::get_code(message, segments, version, level,
+                                 data.data());
+        ReedSolomon::Code code = rs.encode(message, level);
+        QRMatrix unmasked;
+        PipelineStages::fill(version, code.data(), code.size(), unmasked);
+        QRMatrix matrix;
+        int mask = qr.generate(code.data(), code.size(), matrix, level);
+        ReedSolomon::Code corrupted = inject_errors(code, level, 1);
+        std::vector<uint8_t> image;
+
+        auto add = [&](const std::string& name,
+                       const std::function<void()>& op) {
+            if (selected(options, name)) {
+                results.push_back(measure(options, name, size, version, op));
+            }
+        };
+        add("choose_version", [&] {
+            sink += ReedSolomon::choose_version(message, level, &segments);
+        });
+        add("get_code", [&] {
+            PipelineStages::get_code(message, segments, version, level,
+                                     data.data());
+            sink += data[0];
+        });
+        add("encode_message", [&] {
+            rs.encode_message(data.data(), version, level, code.data());
+            sink += code.back();
+        });
+        add("rs_decode", [&] {
+            sink += rs.decode(corrupted, level).size();
+        });
+        add("generate_module_sequence", [&] {
+            sink += PipelineStages::module_sequence(version);
+        });
+        add("fill_matrix", [&] {
+            PipelineStages::fill(version, code.data(), code.size(), matrix);
+            sink += matrix.data()[0];
+        });
+        add("select_mask", [&] {
+            sink += PipelineStages::select_mask(version, level, unmasked);
+        });
+        add("apply_mask", [&] {
+            matrix.copy_from(unmasked);
+            PipelineStages::apply_mask(version, level, mask, matrix);
+            sink += matrix.data()[0];
+        });
+        add("generate_spec_lines", [&] {
+            PipelineStages::spec_lines(version, matrix);
+            sink += matrix.data()[0];
+        });
+        add("generate", [&] {
+            sink += qr.generate(code.data(), code.size(), matrix, level);
+        });
+        add("render_ppm", [&] {
+            render_image(matrix, RenderOptions(), image);
+            sink += image.size();
+        });
+        add("render_svg", [&] {
+            render_image(matrix, {10, 0, ImageFormat::SVG}, image);
+            sink += image.size();
+        });
+        // Предпросмотр: сообщение закодировано, меняется только масштаб
+        // или маска, каждый вызов — один проход writer
+        EncoderSession session;
+        session.set_message(message, level);
+        int preview = 0;
+        add("session_rerender", [&] {
+            RenderOptions render;
+            render.scale = 10 + (++preview & 1);
+            sink += session.render(render).size();
+        });
+        add("session_remask", [&] {
+            sink += session.render(RenderOptions(), ++preview & 7).size();
+        });
+        std::string path = options.output_dir + "/qr_bench.ppm";
+        add("save_qr_to_ppm", [&] { save_qr_to_ppm(matrix, path); });
+        if (selected(options, "save_qr_to_ppm")) std::remove(path.c_str());
+    }
+}
+
+// Сквозной цикл encode -> generate -> PPM в памяти, каждый поток со своими
+// объектами и буфером
+void run_end_to_end(const BenchOptions& options,
+                    std::vector<Result>& results) {
+    if (!selected(options, "end_to_end")) return;
+    for (size_t size : options.e2e_sizes) {
+        std::vector<std::string> payloads;
+        for (uint32_t i = 0; i < 64; ++i) {
+            payloads.push_back(make_payload(size, i * 7919 + 1));
+        }
+        int version;
+        try {
+            version = ReedSolomon::choose_version(payloads[0], options.level);
+        } catch (const std::exception&) {
+            continue;
+        }
+        for (int threads : options.threads) {
+            std::vector<double> samples;
+            uint64_t total = 0;
+            for (int r = 0; r < options.repeats; ++r) {
+                std::atomic<bool> stop{false};
+                std::atomic<uint64_t> codes{0};
+                std::vector<std::thread> workers;
+                Clock::time_point start = Clock::now();
+                for (int t = 0; t < threads; ++t) {
+                    workers.emplace_back([&, t] {
+                        ReedSolomon rs;
+                        QRCode qr;
+                        QRMatrix matrix;
+                        std::vector<uint8_t> image;
+                        uint64_t done = 0;
+                        for (size_t i = t;
+                             !stop.load(std::memory_order_relaxed);
+                             ++i, ++done) {
+                            ReedSolomon::Code code = rs.encode(
+                                payloads[i % payloads.size()], options.level);
+                            qr.generate(code.data(), code.size(), matrix,
+                                        options.level);
+                            render_image(matrix, RenderOptions(), image);
+                        }
+                        codes += done;
+                    });
+                }
+                std::this_thread::sleep_for(
+                    std::chrono::duration<double>(options.min_time));
+                stop = true;
+                for (std::thread& worker : workers) worker.join();
+                double elapsed = seconds_since(start);
+                samples.push_back(codes / elapsed);
+                total += codes;
+            }
+            std::sort(samples.begin(), samples.end());
+            Result result;
+            result.name = "end_to_end";
+            result.payload = size;
+            result.version = version;
+            result.threads = threads;
+            result.iterations = total;
+            result.ops_per_sec = samples[samples.size() / 2];
+            result.ns_per_op = 1e9 / result.ops_per_sec;
+            results.push_back(result);
+        }
+    }
+}
+
+void print_results(const BenchOptions& options,
+                   const std::vector<Result>& results) {
+    const char* kernel = gf256::region_kernels().name;
+    switch (options.format) {
+        case BenchOptions::Format::TEXT:
+            std::printf("GF(256) kernel: %s\n", kernel);
+            std::printf("%-26s %8s %7s %7s %14s %14s\n", "stage", "payload",
+                        "version", "threads", "ns/op", "ops/s");
+            for (const Result& r : results) {
+                std::printf("%-26s %8zu %7d %7d %14.1f %14.1f\n",
+                            r.name.c_str(), r.payload, r.version, r.threads,
+                            r.ns_per_op, r.ops_per_sec);
+            }
+            break;
+        case BenchOptions::Format::CSV:
+            std::printf(
+                "stage,payload,version,threads,iterations,ns_per_op,"
+                "ops_per_sec,kernel\n");
+            for (const Result& r : results) {
+                std::printf("%s,%zu,%d,%d,%llu,%.1f,%.1f,%s\n", r.name.c_str(),
+                            r.payload, r.version, r.threads,
+                            static_cast<unsigned long long>(r.iterations),
+                            r.ns_per_op, r.ops_per_sec, kernel);
+            }
+            break;
+        case BenchOptions::Format::JSON:
+            std::printf("{\"kernel\":\"%s\",\"hardware_threads\":%u,"
+                        "\"results\":[",
+                        kernel, std::thread::hardware_concurrency());
+            for (size_t i = 0; i < results.size(); ++i) {
+                const Result& r = results[i];
+                std::printf("%s\n{\"stage\":\"%s\",\"payload\":%zu,"
+                            "\"version\":%d,\"threads\":%d,"
+                            "\"iterations\":%llu,\"ns_per_op\":%.1f,"
+                            "\"ops_per_sec\":%.1f}",
+                            i ? "," : "", r.name.c_str(), r.payload,
+                            r.version, r.threads,
+                            static_cast<unsigned long long>(r.iterations),
+                            r.ns_per_op, r.ops_per_sec);
+            }
+            std::printf("\n]}\n");
+            break;
+    }
+}
+
+template <typename T>
+std::vector<T> parse_list(const std::string& text) {
+    std::vector<T> values;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        values.push_back(static_cast<T>(std::stoul(item)));
+    }
+    return values;
+}
+
+void print_usage(const char* program) {
+    std::cerr << "Использование: " << program
+              << " [--format text|csv|json] [--min-time S] [--repeats N]\n"
+                 "      [--filter STAGE] [--sizes N,N..] [--e2e-sizes N,N..]"
+                 " [--threads N,N..]\n"
+                 "      [--ecc L|M|Q|H] [--kernel scalar|ssse3|avx2]"
+                 " [--out DIR]\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            bool has_value = i + 1 < argc;
+            if (arg == "--format" && has_value) {
+                std::string format = argv[++i];
+                if (format == "csv") {
+                    options.format = BenchOptions::Format::CSV;
+                } else if (format == "json") {
+                    options.format = BenchOptions::Format::JSON;
+                } else if (format == "text") {
+                    options.format = BenchOptions::Format::TEXT;
+                } else {
+                    throw std::runtime_error("Unknown format " + format);
+                }
+            } else if (arg == "--min-time" && has_value) {
+                options.min_time = std::stod(argv[++i]);
+            } else if (arg == "--repeats" && has_value) {
+                options.repeats = std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--filter" && has_value) {
+                options.filter = argv[++i];
+            } else if (arg == "--sizes" && has_value) {
+                options.sizes = parse_list<size_t>(argv[++i]);
+            } else if (arg == "--e2e-sizes" && has_value) {
+                options.e2e_sizes = parse_list<size_t>(argv[++i]);
+            } else if (arg == "--threads" && has_value) {
+                options.threads = parse_list<int>(argv[++i]);
+            } else if (arg == "--ecc" && has_value) {
+                std::string name = argv[++i];
+                size_t index = std::string("LMQH").find(name);
+                if (name.size() != 1 || index == std::string::npos) {
+                    throw std::runtime_error("Unknown ECC level " + name);
+                }
+                options.level = static_cast<qr_spec::EccLevel>(index);
+            } else if (arg == "--kernel" && has_value) {
+                if (!gf256::select_region_kernels(argv[++i])) {
+                    throw std::runtime_error(
+                        std::string("Kernel unavailable: ") + argv[i]);
+                }
+            } else if (arg == "--out" && has_value) {
+                options.output_dir = argv[++i];
+            } else {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+        if (options.threads.empty()) {
+            int hardware =
+                std::max(1u, std::thread::hardware_concurrency());
+            for (int t = 1; t < hardware; t *= 2) options.threads.push_back(t);
+            options.threads.push_back(hardware);
+        }
+
+        check_constexpr();
+        std::vector<Result> results;
+        run_stages(options, results);
+        run_end_to_end(options, results);
+        print_results(options, results);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,440 @@
+// Монте-Карло оценка живучести символа. В кодовые слова вносятся случайные
+// ошибки, стирания или пятно на модулях, блоки исправляются
+// ReedSolomon::decode_block и сравниваются с исходными. Для каждой силы
+// повреждения печатается доля исправленных символов. Потоки берут испытания
+// пачками; генератор заново засевается в начале каждой пачки от зерна,
+// силы повреждения и номера пачки, поэтому результат при заданном зерне
+// воспроизводим при любом числе потоков и порядке раздачи пачек.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gf256_region.h"
+#include "qr_layout.h"
+#include "qr_matrix.h"
+#include "qr_spec.h"
+#include "reed_solomon.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint64_t TRIAL_CHUNK = 1024;
+
+enum class Model { ERRORS, ERASURES, BURST };
+
+const char* model_name(Model model) {
+    switch (model) {
+        case Model::ERRORS:
+            return "errors";
+        case Model::ERASURES:
+            return "erasures";
+        case Model::BURST:
+            return "burst";
+    }
+    return "";
+}
+
+struct SimOptions {
+    Model model = Model::ERRORS;
+    std::string payload;  // пусто — случайная строка длины size
+    size_t size = 100;
+    qr_spec::EccLevel level = qr_spec::EccLevel::M;
+    int from = 0;
+    int to = -1;   // -1 — вся ECC символа, для пятна — сторона символа
+    int step = 0;  // 0 — около 20 точек
+    uint64_t trials = 100000;
+    int threads = 0;  // 0 — по числу ядер
+    uint64_t seed = 1;
+    bool csv = false;
+};
+
+// Кодовые слова символа, разложенные по блокам, и обратные отображения
+// из позиций символа и из модулей
+struct Subject {
+    int version = 0;
+    int size = 0;  // сторона в модулях
+    qr_spec::BlockLayout layout;
+    std::vector<uint8_t> blocks;     // блоки подряд: данные, затем ECC
+    std::vector<int> block_start;    // начало блока в blocks и общий конец
+    std::vector<int> slot;           // позиция в символе -> индекс в blocks
+    std::vector<int> slot_block;     // позиция в символе -> номер блока
+    std::vector<int> module_bit;     // модуль r * size + c -> номер бита
+};
+
+Subject make_subject(const ReedSolomon::Code& code, qr_spec::EccLevel level) {
+    Subject s;
+    int total = static_cast<int>(code.size());
+    s.version = qr_spec::version_for_codewords(total);
+    s.size = qr_spec::symbol_size(s.version);
+    s.layout = qr_spec::block_layout(s.version, level);
+
+    s.block_start.push_back(0);
+    for (int b = 0; b < s.layout.blocks; ++b) {
+        s.block_start.push_back(s.block_start.back() +
+                                s.layout.data_length(b) + s.layout.ecc);
+    }
+    s.blocks.resize(total);
+    s.slot.resize(total);
+    s.slot_block.resize(total);
+    for (int pos = 0; pos < total; ++pos) {
+        int block = 0;
+        int index = 0;
+        s.layout.locate(pos, block, index);
+        s.slot[pos] = s.block_start[block] + index;
+        s.slot_block[pos] = block;
+        s.blocks[s.slot[pos]] = code[pos];
+    }
+
+    // Тот же обход, что у generate_module_sequence; остаточные биты и
+    // служебные модули не принадлежат ни одному кодовому слову
+    QRMatrix reserved(s.size);
+    qr_layout::fill_reserved(s.version, reserved);
+    s.module_bit.assign(static_cast<size_t>(s.size) * s.size, -1);
+    int index = 0;
+    qr_layout::walk_data_modules(reserved, [&](int r, int c) {
+        if (index < total * 8) s.module_bit[r * s.size + c] = index;
+        ++index;
+    });
+    return s;
+}
+
+// Счётчики одной точки кривой
+struct Tally {
+    uint64_t corrected = 0;
+    uint64_t miscorrected = 0;  // декодер принял неверный блок
+    uint64_t failed = 0;
+    uint64_t decodes = 0;       // вызовов decode_block
+
+    void add(const Tally& other) {
+        corrected += other.corrected;
+        miscorrected += other.miscorrected;
+        failed += other.failed;
+        decodes += other.decodes;
+    }
+};
+
+// Испытания одного потока; буферы выделяются один раз
+class Simulator {
+   public:
+    explicit Simulator(const Subject& subject)
+        : subject_(subject),
+          work_(subject.blocks.size()),
+          order_(subject.slot.size()),
+          touched_(subject.layout.blocks),
+          erase_pos_(subject.layout.blocks * (subject.layout.ecc + 1)),
+          erase_count_(subject.layout.blocks) {}
+
+    // Начало пачки: новое зерно и исходная перестановка позиций, чтобы
+    // испытания пачки не зависели от предыдущих на этом потоке
+    void reseed(std::seed_seq& seed) {
+        rng_.seed(seed);
+        for (size_t i = 0; i < order_.size(); ++i) {
+            order_[i] = static_cast<int>(i);
+        }
+    }
+
+    void run(Model model, int damage, Tally& tally) {
+        std::copy(subject_.blocks.begin(), subject_.blocks.end(),
+                  work_.begin());
+        std::fill(touched_.begin(), touched_.end(), 0);
+        std::fill(erase_count_.begin(), erase_count_.end(), 0);
+        switch (model) {
+            case Model::ERRORS:
+                for (int k = 0; k < damage; ++k) {
+                    int pos = pick(k);
+                    work_[subject_.slot[pos]] ^=
+                        static_cast<uint8_t>(1 + rng_() % 255);
+                    touched_[subject_.slot_block[pos]] = 1;
+                }
+                break;
+            case Model::ERASURES:
+                for (int k = 0; k < damage; ++k) erase(pick(k));
+                break;
+            case Model::BURST:
+                smudge(damage);
+                break;
+        }
+
+        bool miscorrected = false;
+        for (int b = 0; b < subject_.layout.blocks; ++b) {
+            if (!touched_[b]) continue;
+            int start = subject_.block_start[b];
+            int n = subject_.block_start[b + 1] - start;
+            int ecc = subject_.layout.ecc;
+            ++tally.decodes;
+            ReedSolomon::DecodeResult result = solomon_.decode_block(
+                &work_[start], n, ecc, &erase_pos_[b * (ecc + 1)],
+                erase_count_[b]);
+            if (!result.ok) {
+                ++tally.failed;
+                return;
+            }
+            miscorrected = miscorrected ||
+                           !std::equal(work_.begin() + start,
+                                       work_.begin() + start + n,
+                                       subject_.blocks.begin() + start);
+        }
+        ++(miscorrected ? tally.miscorrected : tally.corrected);
+    }
+
+   private:
+    // k-я из различных случайных позиций символа (частичное перемешивание)
+    int pick(int k) {
+        size_t n = order_.size();
+        size_t j = k + rng_() % (n - k);
+        std::swap(order_[k], order_[j]);
+        return order_[k];
+    }
+
+    // Стирание позиции: значение неизвестно, место известно декодеру.
+    // Сверх ecc + 1 стираний блок всё равно не исправить, их не храним.
+    void erase(int pos) {
+        int block = subject_.slot_block[pos];
+        int ecc = subject_.layout.ecc;
+        work_[subject_.slot[pos]] = static_cast<uint8_t>(rng_());
+        touched_[block] = 1;
+        if (erase_count_[block] <= ecc) {
+            erase_pos_[block * (ecc + 1) + erase_count_[block]++] =
+                subject_.slot[pos] - subject_.block_start[block];
+        }
+    }
+
+    // Квадрат side x side в случайном месте: каждый модуль пятна получает
+    // случайный цвет, то есть меняется с вероятностью 1/2
+    void smudge(int side) {
+        int size = subject_.size;
+        if (side <= 0) return;
+        side = std::min(side, size);
+        int top = static_cast<int>(rng_() % (size - side + 1));
+        int left = static_cast<int>(rng_() % (size - side + 1));
+        uint64_t bits = 0;
+        int available = 0;
+        for (int r = top; r < top + side; ++r) {
+            for (int c = left; c < left + side; ++c) {
+                int bit = subject_.module_bit[r * size + c];
+                if (bit < 0) continue;
+                if (available == 0) {
+                    bits = rng_();
+                    available = 64;
+                }
+                bool flip = bits & 1;
+                bits >>= 1;
+                --available;
+                if (!flip) continue;
+                int pos = bit / 8;
+                work_[subject_.slot[pos]] ^=
+                    static_cast<uint8_t>(0x80 >> (bit % 8));
+                touched_[subject_.slot_block[pos]] = 1;
+            }
+        }
+    }
+
+    const Subject& subject_;
+    ReedSolomon solomon_;
+    std::mt19937_64 rng_;
+    std::vector<uint8_t> work_;
+    std::vector<int> order_;
+    std::vector<uint8_t> touched_;
+    std::vector<int> erase_pos_;  // по ecc + 1 мест на блок
+    std::vector<int> erase_count_;
+};
+
+std::string make_payload(size_t size, uint64_t seed) {
+    static const char ALPHABET[] =
+        "abcdefghijklmnopqrstuvwxyz0123456789/.-_?=&";
+    std::mt19937 rng(static_cast<uint32_t>(seed));
+    std::string payload(size, '\0');
+    for (char& c : payload) c = ALPHABET[rng() % (sizeof(ALPHABET) - 1)];
+    return payload;
+}
+
+double percent(uint64_t part, uint64_t total) {
+    return total == 0 ? 0 : 100.0 * part / total;
+}
+
+void run(const SimOptions& options) {
+    std::string payload = options.payload.empty()
+                              ? make_payload(options.size, options.seed)
+                              : options.payload;
+    ReedSolomon solomon;
+    ReedSolomon::Code code = solomon.encode(payload, options.level);
+    Subject subject = make_subject(code, options.level);
+
+    int total = static_cast<int>(code.size());
+    int ecc_total = subject.layout.blocks * subject.layout.ecc;
+    int limit = options.model == Model::BURST ? subject.size : total;
+    int to = options.to >= 0 ? options.to
+             : options.model == Model::BURST ? subject.size
+                                              : ecc_total;
+    to = std::min(to, limit);
+    int from = std::min(std::max(options.from, 0), to);
+    int step = options.step > 0 ? options.step : std::max(1, (to - from) / 20);
+    int threads = options.threads;
+    if (threads <= 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    const char* damage = options.model == Model::BURST ? "side" : "count";
+    if (options.csv) {
+        std::printf("model,%s,trials,corrected,miscorrected,failed,"
+                    "trials_per_sec,decodes_per_sec\n",
+                    damage);
+    } else {
+        std::printf("payload %zu bytes, version %d, level %c, %d blocks x "
+                    "%d ECC, %d codewords\n",
+                    payload.size(), subject.version,
+                    "LMQH"[static_cast<int>(options.level)],
+                    subject.layout.blocks, subject.layout.ecc, total);
+        std::printf("model %s, %d threads, GF(256) kernel %s\n",
+                    model_name(options.model), threads,
+                    gf256::region_kernels().name);
+        std::printf("%8s %10s %10s %12s %8s %14s %14s\n", damage, "trials",
+                    "corrected%", "miscorrect%", "failed%", "trials/s",
+                    "decodes/s");
+    }
+
+    Tally overall;
+    Clock::time_point overall_start = Clock::now();
+    for (int point = from; point <= to; point += step) {
+        std::atomic<uint64_t> next{0};
+        std::vector<Tally> tallies(threads);
+        std::vector<std::thread> workers;
+        Clock::time_point start = Clock::now();
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                Simulator simulator(subject);
+                Tally& tally = tallies[t];
+                for (;;) {
+                    uint64_t first = next.fetch_add(TRIAL_CHUNK);
+                    if (first >= options.trials) break;
+                    uint64_t last =
+                        std::min(options.trials, first + TRIAL_CHUNK);
+                    std::seed_seq seed{options.seed, uint64_t(point),
+                                       first / TRIAL_CHUNK};
+                    simulator.reseed(seed);
+                    for (uint64_t i = first; i < last; ++i) {
+                        simulator.run(options.model, point, tally);
+                    }
+                }
+            });
+        }
+        for (std::thread& worker : workers) worker.join();
+        double seconds =
+            std::chrono::duration<double>(Clock::now() - start).count();
+
+        Tally tally;
+        for (const Tally& t : tallies) tally.add(t);
+        overall.add(tally);
+        uint64_t trials = options.trials;
+        if (options.csv) {
+            std::printf("%s,%d,%llu,%llu,%llu,%llu,%.1f,%.1f\n",
+                        model_name(options.model), point,
+                        static_cast<unsigned long long>(trials),
+                        static_cast<unsigned long long>(tally.corrected),
+                        static_cast<unsigned long long>(tally.miscorrected),
+                        static_cast<unsigned long long>(tally.failed),
+                        trials / seconds, tally.decodes / seconds);
+        } else {
+            std::printf("%8d %10llu %10.3f %12.3f %8.3f %14.1f %14.1f\n",
+                        point, static_cast<unsigned long long>(trials),
+                        percent(tally.corrected, trials),
+                        percent(tally.miscorrected, trials),
+                        percent(tally.failed, trials), trials / seconds,
+                        tally.decodes / seconds);
+        }
+        std::fflush(stdout);
+    }
+    if (!options.csv) {
+        double seconds = std::chrono::duration<double>(Clock::now() -
+                                                       overall_start)
+                             .count();
+        std::printf("total %llu decodes in %.2f s, %.1f decodes/s\n",
+                    static_cast<unsigned long long>(overall.decodes), seconds,
+                    overall.decodes / seconds);
+    }
+}
+
+void print_usage(const char* program) {
+    std::cerr << "Использование: " << program
+              << " [--model errors|erasures|burst] [--payload TEXT | --size N]"
+                 "\n      [--ecc L|M|Q|H] [--from N] [--to N] [--step N]"
+                 " [--trials N]\n"
+                 "      [--threads N] [--seed N] [--format text|csv]"
+                 " [--kernel scalar|ssse3|avx2]\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    SimOptions options;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            bool has_value = i + 1 < argc;
+            if (arg == "--model" && has_value) {
+                std::string model = argv[++i];
+                if (model == "errors") {
+                    options.model = Model::ERRORS;
+                } else if (model == "erasures") {
+                    options.model = Model::ERASURES;
+                } else if (model == "burst") {
+                    options.model = Model::BURST;
+                } else {
+                    throw std::runtime_error("Unknown model " + model);
+                }
+            } else if (arg == "--payload" && has_value) {
+                options.payload = argv[++i];
+            } else if (arg == "--size" && has_value) {
+                options.size = std::stoul(argv[++i]);
+            } else if (arg == "--ecc" && has_value) {
+                std::string name = argv[++i];
+                size_t index = std::string("LMQH").find(name);
+                if (name.size() != 1 || index == std::string::npos) {
+                    throw std::runtime_error("Unknown ECC level " + name);
+                }
+                options.level = static_cast<qr_spec::EccLevel>(index);
+            } else if (arg == "--from" && has_value) {
+                options.from = std::stoi(argv[++i]);
+            } else if (arg == "--to" && has_value) {
+                options.to = std::stoi(argv[++i]);
+            } else if (arg == "--step" && has_value) {
+                options.step = std::stoi(argv[++i]);
+            } else if (arg == "--trials" && has_value) {
+                options.trials = std::stoull(argv[++i]);
+            } else if (arg == "--threads" && has_value) {
+                options.threads = std::stoi(argv[++i]);
+            } else if (arg == "--seed" && has_value) {
+                options.seed = std::stoull(argv[++i]);
+            } else if (arg == "--format" && has_value) {
+                std::string format = argv[++i];
+                if (format != "text" && format != "csv") {
+                    throw std::runtime_error("Unknown format " + format);
+                }
+                options.csv = format == "csv";
+            } else if (arg == "--kernel" && has_value) {
+                if (!gf256::select_region_kernels(argv[++i])) {
+                    throw std::runtime_error(
+                        std::string("Kernel unavailable: ") + argv[i]);
+                }
+            } else {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+        run(options);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "image_writer.h"
+#include "qr_spec.h"
+
+// Лист символов: сетка columns x rows одинаковых плиток в одном PPM/PBM.
+// Сторона плитки — наибольший символ набора с рамкой render.quiet_zone;
+// меньшие символы центрируются с точностью до модуля. Файл листа заранее
+// выделяется и отображается в память, рабочие потоки берут полосы из
+// одного ряда плиток и рисуют их прямо в отображение.
+struct AtlasOptions {
+    int columns = 10;
+    int rows = 0;     // рядов на листе, 0 — все символы на одном листе
+    int margin = 10;  // пикселей между плитками и по краям листа
+    int threads = 0;  // 0 — по числу ядер
+    qr_spec::EccLevel level = qr_spec::EccLevel::L;
+    RenderOptions render;
+    // payloads — части одного сообщения по порядку (не больше 16), каждая
+    // получает заголовок Structured Append
+    bool structured_append = false;
+};
+
+struct AtlasStats {
+    size_t symbols = 0;
+    size_t failed = 0;  // не удалось закодировать, плитка пустая
+    size_t sheets = 0;
+    int tile = 0;  // сторона плитки в пикселях
+    double seconds = 0;
+};
+
+// Пишет payloads в filename; при нескольких листах к имени перед
+// расширением добавляется номер листа (_000, _001, ...)
+AtlasStats write_atlas(const std::vector<std::string> &payloads,
+                       const std::string &filename,
+                       const AtlasOptions &options);
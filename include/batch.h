@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string>
+
+#include "image_writer.h"
+#include "qr_spec.h"
+
+// Пакетная генерация: записи читаются из файла или stdin порциями и
+// распределяются по пулу потоков, у каждого свои ReedSolomon и QRCode.
+// Результат записи с номером i сохраняется в output_dir/<i>.ppm (.pbm).
+// С verify файлы не создаются: готовые изображения читаются из output_dir
+// и сравниваются с записями, расхождения считаются ошибками. Номер и
+// причина каждой ошибки (первых ста) печатаются в stderr.
+struct BatchOptions {
+    std::string input = "-";        // путь к файлу или "-" для stdin
+    std::string output_dir = ".";
+    int threads = 0;                // 0 — по числу ядер
+    bool length_delimited = false;  // 4-байтовая длина (big-endian) + данные
+    size_t chunk_size = 1024;       // записей в одной порции
+    qr_spec::EccLevel level = qr_spec::EccLevel::L;
+    RenderOptions render;
+    size_t cache_bytes = 0;  // бюджет общего кэша символов, 0 — без кэша
+    bool verify = false;
+};
+
+struct BatchStats {
+    size_t records = 0;
+    size_t failed = 0;
+    double seconds = 0;
+    uint64_t cache_hits = 0;
+    uint64_t cache_misses = 0;
+};
+
+// Читает следующую запись: строку (без \r\n) или запись с длиной
+bool read_record(std::istream& in, bool length_delimited,
+                 std::string& payload);
+
+BatchStats run_batch(const BatchOptions& options);
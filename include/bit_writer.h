@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+// Запись битового потока старшим битом вперёд в буфер вызывающего.
+// Биты копятся в 64-битном аккумуляторе и сбрасываются по 4 байта,
+// выровненные байтовые данные копируются memcpy.
+class BitWriter {
+   public:
+    BitWriter(uint8_t* out, size_t capacity)
+        : out_(out), capacity_(capacity) {}
+
+    // Добавляет count (0..32) младших битов value
+    void append(uint32_t value, int count) {
+        if (count == 0) return;
+        acc_ = (acc_ << count) | (value & (0xFFFFFFFFull >> (32 - count)));
+        acc_bits_ += count;
+        if (acc_bits_ >= 32) {
+            reserve(4);
+            acc_bits_ -= 32;
+            uint32_t word = static_cast<uint32_t>(acc_ >> acc_bits_);
+            out_[pos_] = static_cast<uint8_t>(word >> 24);
+            out_[pos_ + 1] = static_cast<uint8_t>(word >> 16);
+            out_[pos_ + 2] = static_cast<uint8_t>(word >> 8);
+            out_[pos_ + 3] = static_cast<uint8_t>(word);
+            pos_ += 4;
+        }
+    }
+
+    void append_bytes(const uint8_t* data, size_t n) {
+        if (acc_bits_ % 8 == 0) {
+            flush();
+            reserve(n);
+            std::memcpy(out_ + pos_, data, n);
+            pos_ += n;
+            return;
+        }
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            append(uint32_t(data[i]) << 24 | uint32_t(data[i + 1]) << 16 |
+                       uint32_t(data[i + 2]) << 8 | data[i + 3],
+                   32);
+        }
+        for (; i < n; ++i) append(data[i], 8);
+    }
+
+    // Терминатор (до 4 нулевых битов), выравнивание до байта и
+    // чередующиеся байты-заполнители 0xEC, 0x11 до capacity байтов
+    void pad(size_t capacity) {
+        size_t bits = bit_size();
+        size_t free_bits = capacity * 8 - bits;
+        append(0, static_cast<int>(free_bits < 4 ? free_bits : 4));
+        append(0, static_cast<int>((8 - bit_size() % 8) % 8));
+        flush();
+        for (bool first = true; pos_ < capacity; first = !first) {
+            reserve(1);
+            out_[pos_++] = first ? 0xEC : 0x11;
+        }
+    }
+
+    // Сбрасывает аккумулятор, неполный байт дополняется нулями
+    void flush() {
+        if (acc_bits_ % 8 != 0) append(0, 8 - acc_bits_ % 8);
+        reserve(acc_bits_ / 8);
+        while (acc_bits_ > 0) {
+            acc_bits_ -= 8;
+            out_[pos_++] = static_cast<uint8_t>(acc_ >> acc_bits_);
+        }
+        acc_ = 0;
+    }
+
+    size_t bit_size() const { return pos_ * 8 + acc_bits_; }
+    size_t byte_size() const { return pos_; }
+
+   private:
+    void reserve(size_t n) const {
+        if (pos_ + n > capacity_) {
+            throw std::runtime_error("Bit stream exceeds buffer capacity");
+        }
+    }
+
+    uint8_t* out_;
+    size_t capacity_;
+    size_t pos_ = 0;
+    uint64_t acc_ = 0;
+    int acc_bits_ = 0;
+};
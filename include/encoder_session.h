@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "image_writer.h"
+#include "qr_code.h"
+#include "qr_matrix.h"
+#include "qr_spec.h"
+#include "reed_solomon.h"
+
+// Сеанс кодирования одного сообщения для предпросмотра. Промежуточные
+// результаты конвейера хранятся, и каждый этап пересчитывается только при
+// смене того, от чего он зависит:
+//
+//   сообщение, уровень -> данные -> ECC -> раскладка без маски
+//   маска              -> символ с маской и информацией о формате
+//   параметры рендера  -> изображение
+//
+// Символы по маскам хранятся все восемь, поэтому переключение маски после
+// первого показа стоит только прохода writer. Объект не потокобезопасен.
+class EncoderSession {
+   public:
+    using EccLevel = qr_spec::EccLevel;
+
+    // Число выполненных этапов, для проверки кэширования
+    struct Stats {
+        size_t encodes = 0;    // сегментация, данные, ECC и раскладка
+        size_t masks = 0;      // маска с информацией о формате
+        size_t penalties = 0;  // оценки штрафа при выборе маски
+        size_t renders = 0;
+    };
+
+    EncoderSession() = default;
+
+    // Новое сообщение или уровень сбрасывают все этапы; те же — ничего
+    void set_message(const std::string &message,
+                     EccLevel level = EccLevel::L);
+
+    // Символ с маской mask, AUTO_MASK — с наименьшим штрафом
+    const QRMatrix &symbol(int mask = QRCode::AUTO_MASK);
+    // Изображение символа; при тех же маске и options — прежний буфер
+    const std::vector<uint8_t> &render(const RenderOptions &options,
+                                       int mask = QRCode::AUTO_MASK);
+    // Маска с наименьшим штрафом, как у QRCode::generate
+    int best_mask();
+
+    int version() const { return version_; }
+    EccLevel level() const { return level_; }
+    const std::vector<uint8_t> &data_codewords() const { return data_; }
+    const ReedSolomon::Code &codewords() const { return codewords_; }
+    const QRMatrix &unmasked() const { return unmasked_; }
+    const Stats &stats() const { return stats_; }
+
+   private:
+    int resolve_mask(int mask);
+
+    ReedSolomon solomon_;
+    std::string message_;
+    EccLevel level_ = EccLevel::L;
+    bool ready_ = false;
+    int version_ = 0;
+
+    std::vector<uint8_t> data_;
+    ReedSolomon::Code codewords_;
+    QRMatrix unmasked_;
+
+    QRMatrix masked_[QRCode::MASK_COUNT];
+    bool masked_ready_[QRCode::MASK_COUNT] = {};
+    int best_mask_ = QRCode::AUTO_MASK;  // AUTO_MASK — ещё не выбрана
+
+    std::vector<uint8_t> image_;
+    RenderOptions image_options_;
+    int image_mask_ = QRCode::AUTO_MASK;  // AUTO_MASK — изображения нет
+
+    Stats stats_;
+};
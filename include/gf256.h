@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// Арифметика поля Галуа GF(256) с порождающим многочленом 0x11d.
+// Все таблицы вычисляются на этапе компиляции и лежат в памяти только для
+// чтения, поэтому функции не имеют состояния и безопасны для любых потоков.
+namespace gf256 {
+
+constexpr int PRIMITIVE = 0x11d;
+
+// Побитовое умножение без таблиц, нужно только для их построения
+constexpr int mul_no_lut(int x, int y) {
+    int r = 0;
+    while (y > 0) {
+        if (y & 1) r ^= x;
+        y >>= 1;
+        x <<= 1;
+        if (x & 0x100) x ^= PRIMITIVE;
+    }
+    return r;
+}
+
+struct Tables {
+    std::array<uint8_t, 512> exp{};  // Экспоненциальная таблица (удвоенная)
+    std::array<uint8_t, 256> log{};  // Логарифмическая таблица
+};
+
+constexpr Tables make_tables() {
+    Tables t;
+    int x = 1;
+    for (int i = 0; i < 255; ++i) {
+        t.exp[i] = static_cast<uint8_t>(x);
+        t.log[x] = static_cast<uint8_t>(i);
+        x = mul_no_lut(x, 2);
+    }
+    for (int i = 255; i < 512; ++i) {
+        t.exp[i] = t.exp[i - 255];
+    }
+    return t;
+}
+
+inline constexpr Tables TABLES = make_tables();
+
+constexpr int exp(int power) { return TABLES.exp[power]; }
+constexpr int log(int x) { return TABLES.log[x]; }
+
+#ifdef QR_GF256_MUL_TABLE
+// Полная таблица умножения 256x256 (64 КБ): одна загрузка на произведение
+struct MulTable {
+    std::array<std::array<uint8_t, 256>, 256> v{};
+};
+
+constexpr MulTable make_mul_table() {
+    MulTable t;
+    for (int x = 1; x < 256; ++x) {
+        for (int y = 1; y < 256; ++y) {
+            t.v[x][y] = TABLES.exp[TABLES.log[x] + TABLES.log[y]];
+        }
+    }
+    return t;
+}
+
+inline constexpr MulTable MUL_TABLE = make_mul_table();
+
+constexpr int mul(int x, int y) { return MUL_TABLE.v[x][y]; }
+#else
+constexpr int mul(int x, int y) {
+    if (x == 0 || y == 0) return 0;
+    return TABLES.exp[TABLES.log[x] + TABLES.log[y]];
+}
+#endif
+
+constexpr int div(int x, int y) {
+    if (x == 0) return 0;
+    return TABLES.exp[TABLES.log[x] + 255 - TABLES.log[y]];
+}
+
+// Степень допускает отрицательный показатель: x^-k = (x^-1)^k
+constexpr int pow(int x, int power) {
+    if (power == 0) return 1;
+    if (x == 0) return 0;
+    int e = (TABLES.log[x] * power) % 255;
+    if (e < 0) e += 255;
+    return TABLES.exp[e];
+}
+
+constexpr int inverse(int x) { return TABLES.exp[255 - TABLES.log[x]]; }
+
+}  // namespace gf256
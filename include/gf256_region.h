@@ -0,0 +1,102 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "gf256.h"
+
+// Операции GF(256) над массивами байтов. Умножение на константу c идёт по
+// таблицам полубайтов: c * x = lo[c][x & 15] ^ hi[c][x >> 4], так что
+// 16 или 32 байта умножаются двумя перестановками pshufb. Ядро (SSSE3,
+// AVX2 или скалярное) выбирается по возможностям процессора при первом
+// вызове.
+namespace gf256 {
+
+constexpr int MAX_GENERATOR_DEGREE = 30;
+
+// Генераторы Рида — Соломона g_n(x) = (x - a^0)...(x - a^(n-1)):
+// coef[n][j] — коэффициент g_n[j + 1], старшая единица опущена
+struct GeneratorPolys {
+    std::array<std::array<uint8_t, MAX_GENERATOR_DEGREE>,
+               MAX_GENERATOR_DEGREE + 1>
+        coef{};
+};
+
+constexpr GeneratorPolys make_generator_polys() {
+    GeneratorPolys t;
+    for (int n = 1; n <= MAX_GENERATOR_DEGREE; ++n) {
+        std::array<int, MAX_GENERATOR_DEGREE + 1> poly{};
+        poly[0] = 1;
+        // Умножение на (x - a^i)
+        for (int i = 0; i < n; ++i) {
+            for (int j = i + 1; j > 0; --j) {
+                poly[j] ^= mul(poly[j - 1], exp(i));
+            }
+        }
+        for (int j = 0; j < n; ++j) {
+            t.coef[n][j] = static_cast<uint8_t>(poly[j + 1]);
+        }
+    }
+    return t;
+}
+
+inline constexpr GeneratorPolys GENERATOR_POLYS = make_generator_polys();
+
+struct SplitTables {
+    alignas(16) std::array<std::array<uint8_t, 16>, 256> lo{};
+    alignas(16) std::array<std::array<uint8_t, 16>, 256> hi{};
+};
+
+constexpr SplitTables make_split_tables() {
+    SplitTables t;
+    for (int c = 0; c < 256; ++c) {
+        for (int x = 0; x < 16; ++x) {
+            t.lo[c][x] = static_cast<uint8_t>(mul_no_lut(c, x));
+            t.hi[c][x] = static_cast<uint8_t>(mul_no_lut(c, x << 4));
+        }
+    }
+    return t;
+}
+
+inline constexpr SplitTables SPLIT_TABLES = make_split_tables();
+
+struct RegionKernels {
+    const char* name;
+    // dst[i] = c * src[i]
+    void (*mul)(uint8_t* dst, const uint8_t* src, int c, size_t n);
+    // dst[i] ^= c * src[i]
+    void (*mul_add)(uint8_t* dst, const uint8_t* src, int c, size_t n);
+    // Остаток data(x) * x^nsym по модулю генератора Рида — Соломона
+    // степени nsym с корнями a^0..a^(nsym-1), старший коэффициент первым
+    void (*remainder)(const uint8_t* data, size_t n, int nsym, uint8_t* rem);
+};
+
+// Текущее ядро; выбирается один раз, вызов безопасен из любых потоков
+const RegionKernels& region_kernels();
+
+// Переключает ядро по имени ("scalar", "ssse3", "avx2"); false, если
+// такого ядра нет или процессор его не поддерживает
+bool select_region_kernels(const char* name);
+
+inline void mul_region(uint8_t* dst, const uint8_t* src, int c, size_t n) {
+    region_kernels().mul(dst, src, c, n);
+}
+
+inline void mul_add_region(uint8_t* dst, const uint8_t* src, int c,
+                           size_t n) {
+    region_kernels().mul_add(dst, src, c, n);
+}
+
+inline void rs_remainder(const uint8_t* data, size_t n, int nsym,
+                         uint8_t* rem) {
+    region_kernels().remainder(data, n, nsym, rem);
+}
+
+// Синдромы msg(a^j), j < nsym, сразу для всех j: остаток от деления на
+// генератор вычисляется ядром, затем его значения в корнях набираются
+// умножением строк степеней на коэффициенты остатка. Возвращает true,
+// если есть ненулевой синдром.
+bool syndromes(const uint8_t* msg, size_t n, int nsym, uint8_t* synd);
+
+}  // namespace gf256
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "qr_matrix.h"
+#include "qr_spec.h"
+#include "reed_solomon.h"
+
+// Чтение символов из PPM (P6), PGM (P5) и PBM (P4) для проверки
+// напечатанного. Символ находится по поисковым узорам: левый верхний угол
+// и масштаб — по верхней кромке левого верхнего узора (7 модулей), размер —
+// по правому верхнему и левому нижнему. Изображение не должно быть
+// повёрнуто или искажено: это обратный путь для файлов render_image.
+
+// Выбирает модули символа по центрам клеток из байтов файла в out
+void read_image(const uint8_t *data, size_t size, QRMatrix &out);
+
+// То же для файла, отображённого в память
+void read_image_file(const std::string &filename, QRMatrix &out);
+
+struct DecodedSymbol {
+    int version = 0;
+    qr_spec::EccLevel level = qr_spec::EccLevel::L;
+    int mask = 0;
+    std::string payload;
+    ReedSolomon::DecodeResult correction;
+    qr_segment::AppendHeader append;  // total > 0 — часть набора
+};
+
+// Читает формат, снимает маску, исправляет ошибки и разбирает сегменты
+DecodedSymbol decode_symbol(const QRMatrix &symbol, ReedSolomon &solomon);
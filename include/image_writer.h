@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "qr_matrix.h"
+
+enum class ImageFormat { PPM, PBM, SVG };
+
+struct RenderOptions {
+    int scale = 10;      // пикселей на модуль (для SVG — только размер)
+    int quiet_zone = 0;  // светлая рамка в модулях
+    ImageFormat format = ImageFormat::PPM;
+};
+
+// Заголовок растрового файла PPM (P6) или PBM (P4) и длина строки
+// пикселей в байтах
+std::string image_header(ImageFormat format, int width, int height);
+size_t image_row_bytes(ImageFormat format, int width);
+
+// Закрашивает тёмные модули строки row символа в строке пикселей line,
+// начиная с пикселя x; светлые пиксели не трогает
+void draw_module_row(const QRMatrix &matrix, int row, int scale,
+                     ImageFormat format, uint8_t *line, size_t x);
+
+// Собирает изображение целиком в buffer (буфер переиспользуется между
+// вызовами): каждая масштабированная строка строится один раз и
+// копируется scale раз. PPM (P6) — 3 байта на пиксель, PBM (P4) — 1 бит.
+// SVG — один путь в координатах модулей, где каждая горизонтальная серия
+// тёмных модулей — прямоугольник, поэтому размер файла растёт с числом
+// серий, а не модулей.
+void render_image(const QRMatrix &matrix, const RenderOptions &options,
+                  std::vector<uint8_t> &buffer);
+
+// Записывает готовые байты изображения одним вызовом write
+void write_image_file(const std::string &filename, const uint8_t *data,
+                      size_t size);
+
+// Имя файла с номером index из digits цифр перед расширением:
+// out.ppm -> out_007.ppm
+std::string numbered_filename(const std::string &filename, size_t index,
+                              int digits);
+
+// Собирает изображение в buffer и записывает его одним вызовом write
+void save_image(const QRMatrix &matrix, const std::string &filename,
+                const RenderOptions &options, std::vector<uint8_t> &buffer);
+
+void save_qr_to_ppm(const QRMatrix &matrix, const std::string &filename,
+                    int scale = 10, int quiet_zone = 0);
+void save_qr_to_pbm(const QRMatrix &matrix, const std::string &filename,
+                    int scale = 10, int quiet_zone = 0);
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// Счётчики этапов конвейера: гистограммы времени, число и объём выделений
+// памяти, записанные байты. Код счётчиков есть только в сборке с
+// QR_INSTRUMENTATION, а данные собираются после set_enabled(true); до
+// этого каждый замер стоит одного чтения флага. Каждый поток пишет в свои
+// счётчики, collect() суммирует живые и завершившиеся потоки. Выделения
+// памяти считаются, только если в программу слинкован alloc_hook.cpp,
+// заменяющий глобальные operator new/delete.
+namespace instrument {
+
+enum class Stage {
+    SEGMENT,    // разбиение на сегменты и сборка кодовых слов
+    RS_ENCODE,  // ECC-байты всех блоков
+    RS_DECODE,  // исправление и разбор сегментов
+    PLACEMENT,  // раскладка кодовых слов по матрице
+    MASK,       // выбор и наложение маски
+    RENDER,     // растеризация изображения
+    WRITE,      // запись файла
+    READ,       // разбор изображения и выборка модулей
+    COUNT
+};
+
+constexpr int STAGE_COUNT = static_cast<int>(Stage::COUNT);
+constexpr int HISTOGRAM_BUCKETS = 40;  // корзина k: [2^k, 2^(k+1)) нс
+
+const char* stage_name(Stage stage);
+
+struct StageStats {
+    uint64_t calls = 0;
+    uint64_t total_ns = 0;
+    uint64_t max_ns = 0;
+    uint64_t allocations = 0;  // выделения памяти внутри этапа
+    uint64_t allocated_bytes = 0;
+    uint64_t histogram[HISTOGRAM_BUCKETS] = {};
+};
+
+struct Summary {
+    StageStats stages[STAGE_COUNT];
+    uint64_t allocations = 0;  // все выделения, в том числе вне этапов
+    uint64_t allocated_bytes = 0;
+    uint64_t files_written = 0;
+    uint64_t bytes_written = 0;
+    uint64_t threads = 0;  // потоки, оставившие данные
+};
+
+#ifdef QR_INSTRUMENTATION
+
+namespace detail {
+inline std::atomic<bool> active{false};
+uint64_t now_ns();
+int enter(Stage stage);
+void leave(Stage stage, int previous, uint64_t ns);
+// Учёт выделения памяти текущим этапом; вызывается из alloc_hook.cpp
+void record_allocation(size_t size);
+}  // namespace detail
+
+inline bool enabled() {
+    return detail::active.load(std::memory_order_relaxed);
+}
+inline void set_enabled(bool value) { detail::active.store(value); }
+
+// Замер области видимости; выделения памяти внутри относятся к этапу
+class ScopedStage {
+   public:
+    explicit ScopedStage(Stage stage) {
+        if (!enabled()) return;
+        active_ = true;
+        stage_ = stage;
+        previous_ = detail::enter(stage);
+        start_ = detail::now_ns();
+    }
+    ~ScopedStage() {
+        if (active_) {
+            detail::leave(stage_, previous_, detail::now_ns() - start_);
+        }
+    }
+    ScopedStage(const ScopedStage&) = delete;
+    ScopedStage& operator=(const ScopedStage&) = delete;
+
+   private:
+    bool active_ = false;
+    Stage stage_ = Stage::COUNT;
+    int previous_ = -1;
+    uint64_t start_ = 0;
+};
+
+void record_write(size_t bytes);
+
+#else
+
+constexpr bool enabled() { return false; }
+inline void set_enabled(bool) {}
+
+class ScopedStage {
+   public:
+    explicit ScopedStage(Stage) {}
+};
+
+inline void record_write(size_t) {}
+
+#endif  // QR_INSTRUMENTATION
+
+constexpr bool compiled_in() {
+#ifdef QR_INSTRUMENTATION
+    return true;
+#else
+    return false;
+#endif
+}
+
+Summary collect();
+void print_summary(std::ostream& out, const Summary& summary);
+void print_json(std::ostream& out, const Summary& summary);
+
+// Печатает сводку в stderr при завершении процесса
+void dump_at_exit(bool json);
+
+}  // namespace instrument
@@ -1,62 +1,74 @@
 #pragma once
 
-#include <fstream>
+#include <cstdint>
+#include <string>
 #include <vector>
 
-inline void save_qr_to_ppm(const std::vector<std::vector<int>> &matrix,
-                    const std::string &filename) {
-    int size = matrix.size();
-    int scale = 10;  // Масштабирование для лучшей видимости
-    std::ofstream ofs(filename, std::ios::binary);
-    ofs << "P6\n" << size * scale << " " << size * scale << "\n255\n";
-    for (int i = 0; i < size; i++) {
-        for (int si = 0; si < scale; si++) {
-            for (int j = 0; j < size; j++) {
-                for (int sj = 0; sj < scale; sj++) {
-                    if (matrix[i][j] == 1) {
-                        // Черный пиксель
-                        unsigned char color[3] = {0, 0, 0};
-                        ofs.write(reinterpret_cast<char *>(color), 3);
-                    } else {
-                        // Белый пиксель
-                        unsigned char color[3] = {255, 255, 255};
-                        ofs.write(reinterpret_cast<char *>(color), 3);
-                    }
-                }
-            }
-        }
-    }
-    ofs.close();
-}
+#include "qr_matrix.h"
+#include "qr_spec.h"
 
 class QRCode {
    public:
-    const static int SIZE = 21;
-    const static int MASK_INDEX = 3;
+    using EccLevel = qr_spec::EccLevel;
+    const static int MASK_COUNT = 8;
+    const static int AUTO_MASK = -1;
 
     QRCode() = default;
 
-    std::vector<std::vector<int>> generate(std::vector<int> message);
+    // Строит символ из n кодовых слов (версия определяется по n, уровень
+    // коррекции записывается в информацию о формате) и возвращает номер
+    // маски. AUTO_MASK выбирает маску с наименьшим штрафом. QRCode не
+    // хранит состояния, поэтому один объект можно вызывать из нескольких
+    // потоков; при повторном использовании out память не выделяется.
+    int generate(const uint8_t *codewords, size_t n, QRMatrix &out,
+                 EccLevel level = EccLevel::L, int mask = AUTO_MASK) const;
+    QRMatrix generate(const std::vector<uint8_t> &message,
+                      EccLevel level = EccLevel::L) const;
+
+    // Штраф символа по четырём правилам стандарта
+    static int penalty(const QRMatrix &matrix);
+
+    // Уровень и маска из информации о формате (обратное к apply_mask):
+    // ближайший допустимый код по лучшей из двух копий, не больше 3
+    // ошибочных битов
+    static bool read_format(const QRMatrix &symbol, EccLevel &level,
+                            int &mask);
+    // Снимает маску и собирает кодовые слова символа в порядке обхода
+    // generate_module_sequence. out вмещает MAX_TOTAL_CODEWORDS байтов;
+    // возвращает число слов.
+    static size_t read_codewords(const QRMatrix &symbol, uint8_t *out,
+                                 EccLevel &level, int &mask);
 
    private:
-    std::vector<std::vector<int>> qr_code_ =
-        std::vector<std::vector<int>>(SIZE, std::vector<int>(SIZE, 0));
-
-    std::vector<std::vector<std::vector<int>>> mask_lines = {
-        {{1, 1, 1, 0, 1, 1, 1, 1}, {0, 0, 1, 0, 0, 0, 1, 1}},
-        {{1, 1, 1, 0, 0, 1, 0, 1}, {1, 1, 0, 0, 1, 1, 1, 1}},
-        {{1, 1, 1, 1, 1, 0, 1, 1}, {0, 1, 0, 1, 0, 1, 0, 1}},
-        {{1, 1, 1, 1, 0, 0, 0, 1}, {1, 0, 1, 1, 1, 0, 0, 1}},
-        {{1, 1, 0, 0, 1, 1, 0, 0}, {1, 1, 1, 1, 0, 1, 0, 0}},
-        {{1, 1, 0, 0, 0, 1, 1, 0}, {0, 0, 0, 1, 1, 0, 0, 0}},
-        {{1, 1, 0, 1, 1, 0, 0, 0}, {1, 0, 0, 0, 0, 0, 1, 0}},
-        {{1, 1, 0, 1, 0, 0, 1, 0}, {0, 1, 1, 0, 1, 1, 1, 0}}};
-
-    bool mask_fn(int row, int column);
-    std::vector<std::pair<int, int>> generate_module_sequence();
-    void fill_service_info(std::vector<std::vector<int>> &matrix);
-    void fill_matrix_by_message(const std::vector<int> &message,
-                                std::vector<std::pair<int, int>> &sequence);
-    void apply_mask();
-    void generate_spec_lines();
+    // Отдельные этапы конвейера для qr_bench и EncoderSession
+    friend struct PipelineStages;
+    friend class EncoderSession;
+
+    // Всё, что не зависит от данных: карта служебных модулей, готовый
+    // рисунок узоров, битовые плоскости масок в области данных и адреса
+    // модулей данных (бит row * stride * 64 + column) в порядке обхода
+    struct Template {
+        int version = 0;
+        QRMatrix reserved;
+        QRMatrix patterns;
+        QRMatrix mask_planes[MASK_COUNT];
+        std::vector<uint16_t> placement;
+    };
+
+    static const Template &get_template(int version);
+    static Template build_template(int version);
+
+    static bool mask_fn(int mask, int row, int column);
+    static std::vector<std::pair<int, int>> generate_module_sequence(
+        const QRMatrix &matrix);
+    static void fill_service_info(int version, QRMatrix &matrix);
+    static void fill_matrix_by_message(const Template &tmpl,
+                                       const uint8_t *message, size_t n,
+                                       QRMatrix &out);
+    static void apply_data_mask(const Template &tmpl, int mask,
+                                QRMatrix &out);
+    static int select_mask(const Template &tmpl, EccLevel level,
+                           const QRMatrix &unmasked);
+    static void apply_mask(EccLevel level, int mask, QRMatrix &out);
+    static void generate_spec_lines(int version, QRMatrix &out);
 };
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+#include "gf256.h"
+#include "gf256_region.h"
+#include "qr_layout.h"
+#include "qr_matrix.h"
+#include "qr_spec.h"
+#include "segment_core.h"
+
+// Построение символа на этапе компиляции для строк, известных при сборке:
+//
+//     constexpr qr::Symbol SUPPORT = qr::make("https://example.com/help");
+//
+// Конвейер тот же, что у ReedSolomon::encode и QRCode::generate, и
+// общий с ними код: разбиение и запись сегментов из segment_core.h,
+// генераторы gf256::GENERATOR_POLYS, раскладка и выбор маски из
+// qr_layout. Результат совпадает с генерацией во время выполнения бит в
+// бит. Слишком длинное сообщение даёт ошибку компиляции (исключение в
+// константном выражении).
+namespace qr {
+
+using EccLevel = qr_spec::EccLevel;
+
+struct Symbol {
+    QRMatrix matrix;
+    int version = 0;
+    int mask = 0;
+    EccLevel level = EccLevel::L;
+};
+
+namespace detail {
+
+using Mode = qr_spec::Mode;
+using qr_segment::Segment;
+
+// Не больше одного сегмента на символ; N — длина сообщения плюс один
+template <size_t N>
+struct Plan {
+    std::array<Segment, N> segments{};
+    size_t count = 0;
+};
+
+// Разбиение для группы версий с последней версией last, как в
+// qr_segment::choose_version; возвращает длину в битах или SIZE_MAX
+template <size_t N>
+constexpr size_t plan_group(const std::array<uint8_t, N>& classes, size_t n,
+                            bool numeric, int last, Plan<N>& out) {
+    if (numeric) {
+        out.count = 1;
+        out.segments[0] = Segment{Mode::NUMERIC, 0, n};
+        return qr_segment::segment_bits(Mode::NUMERIC, n, last);
+    }
+    std::array<uint8_t, 3 * N> from{};
+    out.count = qr_segment::plan_segments(classes.data(), n, last,
+                                          from.data(), out.segments.data());
+    return qr_segment::segments_bits(out.segments.data(), out.count, last);
+}
+
+// Битовый поток старшим битом вперёд
+struct BitStream {
+    std::array<uint8_t, qr_spec::MAX_DATA_CODEWORDS> bytes{};
+    size_t bits = 0;
+
+    constexpr void append(uint32_t value, int count) {
+        for (int i = count - 1; i >= 0; --i, ++bits) {
+            if ((value >> i) & 1) {
+                bytes[bits / 8] |= static_cast<uint8_t>(0x80 >> (bits % 8));
+            }
+        }
+    }
+
+    constexpr void append_bytes(const uint8_t* data, size_t n) {
+        for (size_t i = 0; i < n; ++i) append(data[i], 8);
+    }
+
+    // Терминатор, выравнивание до байта и заполнители 0xEC, 0x11
+    constexpr void pad(size_t capacity) {
+        size_t free_bits = capacity * 8 - bits;
+        bits += free_bits < 4 ? free_bits : 4;
+        bits = (bits + 7) / 8 * 8;
+        for (bool first = true; bits < capacity * 8; first = !first) {
+            bytes[bits / 8] = first ? 0xEC : 0x11;
+            bits += 8;
+        }
+    }
+};
+
+// Остаток деления блока на порождающий многочлен степени nsym
+constexpr void rs_remainder(const uint8_t* data, int n, int nsym,
+                            uint8_t* rem) {
+    const auto& poly = gf256::GENERATOR_POLYS.coef[nsym];
+    for (int j = 0; j < nsym; ++j) rem[j] = 0;
+    for (int i = 0; i < n; ++i) {
+        int factor = data[i] ^ rem[0];
+        for (int j = 0; j + 1 < nsym; ++j) {
+            rem[j] = static_cast<uint8_t>(rem[j + 1] ^
+                                          gf256::mul(poly[j], factor));
+        }
+        rem[nsym - 1] =
+            static_cast<uint8_t>(gf256::mul(poly[nsym - 1], factor));
+    }
+}
+
+// Данные и ECC всех блоков, перемежённые как в ReedSolomon::encode_message
+constexpr void interleave(const uint8_t* data, int version, EccLevel level,
+                          uint8_t* out) {
+    qr_spec::BlockLayout layout = qr_spec::block_layout(version, level);
+    for (int b = 0; b < layout.blocks; ++b) {
+        const uint8_t* block = data + layout.data_offset(b);
+        int length = layout.data_length(b);
+        uint8_t ecc[gf256::MAX_GENERATOR_DEGREE] = {};
+        rs_remainder(block, length, layout.ecc, ecc);
+        for (int i = 0; i < length; ++i) {
+            out[layout.data_position(b, i)] = block[i];
+        }
+        for (int j = 0; j < layout.ecc; ++j) {
+            out[layout.ecc_position(b, j)] = ecc[j];
+        }
+    }
+}
+
+constexpr void apply_data_mask(const QRMatrix& reserved, int mask,
+                               QRMatrix& out) {
+    int size = out.size();
+    for (int r = 0; r < size; ++r) {
+        for (int c = 0; c < size; ++c) {
+            if (!reserved.get(r, c) && qr_layout::mask_bit(mask, r, c)) {
+                out.flip(r, c);
+            }
+        }
+    }
+}
+
+}  // namespace detail
+
+// Символ для строкового литерала text; mask — номер маски или -1 для
+// выбора по штрафу, как QRCode::AUTO_MASK
+template <size_t N>
+constexpr Symbol make(const char (&text)[N], EccLevel level = EccLevel::L,
+                      int mask = -1) {
+    size_t n = N - 1;  // без завершающего нуля
+    std::array<uint8_t, N> bytes{};
+    std::array<uint8_t, N> classes{};
+    uint8_t all = qr_segment::CLASS_NUMERIC | qr_segment::CLASS_ALPHANUMERIC;
+    for (size_t i = 0; i < n; ++i) {
+        bytes[i] = static_cast<uint8_t>(text[i]);
+        classes[i] = qr_segment::CHARS.cls[bytes[i]];
+        all &= classes[i];
+    }
+    bool numeric = n > 0 && (all & qr_segment::CLASS_NUMERIC);
+    detail::Plan<N> plan;
+    int version = qr_segment::smallest_version(level, 0, [&](int last) {
+        return detail::plan_group<N>(classes, n, numeric, last, plan);
+    });
+
+    detail::BitStream stream;
+    qr_segment::write_segments(stream, bytes.data(), plan.segments.data(),
+                               plan.count, version);
+    size_t capacity = qr_spec::data_codewords(version, level);
+    stream.pad(capacity);
+
+    std::array<uint8_t, qr_spec::MAX_TOTAL_CODEWORDS> codewords{};
+    detail::interleave(stream.bytes.data(), version, level, codewords.data());
+
+    int size = qr_spec::symbol_size(version);
+    QRMatrix reserved(size);
+    qr_layout::fill_reserved(version, reserved);
+    Symbol symbol;
+    symbol.version = version;
+    symbol.level = level;
+    symbol.matrix.reset(size);
+    qr_layout::draw_patterns(version, symbol.matrix);
+
+    // Остаточные биты в конце обхода остаются нулевыми
+    size_t total_bits = size_t(qr_spec::total_codewords(version)) * 8;
+    size_t index = 0;
+    qr_layout::walk_data_modules(reserved, [&](int r, int c) {
+        if (index < total_bits &&
+            ((codewords[index / 8] >> (7 - index % 8)) & 1)) {
+            symbol.matrix.set(r, c);
+        }
+        ++index;
+    });
+
+    if (mask < 0) {
+        int best_score = 0;
+        for (int m = 0; m < 8; ++m) {
+            QRMatrix candidate = symbol.matrix;
+            detail::apply_data_mask(reserved, m, candidate);
+            qr_layout::write_format(level, m, candidate);
+            int score = qr_layout::penalty(candidate);
+            if (m == 0 || score < best_score) {
+                mask = m;
+                best_score = score;
+            }
+        }
+    } else if (mask >= 8) {
+        throw std::invalid_argument("Invalid mask index");
+    }
+    detail::apply_data_mask(reserved, mask, symbol.matrix);
+    qr_layout::write_format(level, mask, symbol.matrix);
+    symbol.mask = mask;
+    return symbol;
+}
+
+}  // namespace qr
@@ -0,0 +1,261 @@
+#pragma once
+
+#include <array>
+
+#include "qr_matrix.h"
+#include "qr_spec.h"
+
+// Геометрия символа, не зависящая от данных: служебные области, узоры,
+// порядок обхода модулей данных, маски, информация о формате и штраф.
+// Все функции constexpr, поэтому одним кодом пользуются QRCode во время
+// выполнения и qr::make на этапе компиляции.
+namespace qr_layout {
+
+using Word = QRMatrix::Word;
+
+constexpr bool mask_bit(int mask, int row, int column) {
+    switch (mask) {
+        case 0:
+            return (row + column) % 2 == 0;
+        case 1:
+            return row % 2 == 0;
+        case 2:
+            return column % 3 == 0;
+        case 3:
+            return (row + column) % 3 == 0;
+        case 4:
+            return ((row / 2) + (column / 3)) % 2 == 0;
+        case 5:
+            return ((row * column) % 2 + (row * column) % 3) == 0;
+        case 6:
+            return (((row * column) % 2) + ((row * column) % 3)) % 2 == 0;
+        case 7:
+            return (((row + column) % 2) + ((row * column) % 3)) % 2 == 0;
+        default:
+            return false;
+    }
+}
+
+// Отмечает служебные модули: узоры, разделители, области формата и версии
+constexpr void fill_reserved(int version, QRMatrix& matrix) {
+    int size = matrix.size();
+    // Поисковые узоры с разделителями и областями формата
+    matrix.fill_area(0, 0, 9, 9);
+    matrix.fill_area(0, size - 8, 8, 9);
+    matrix.fill_area(size - 8, 0, 9, 8);
+    // Линии синхронизации
+    matrix.fill_area(6, 8, size - 16, 1);
+    matrix.fill_area(8, 6, 1, size - 16);
+
+    std::array<int, 7> align{};
+    int count = qr_spec::alignment_positions(version, align);
+    for (int i = 0; i < count; ++i) {
+        for (int j = 0; j < count; ++j) {
+            if ((i == 0 && j == 0) || (i == 0 && j == count - 1) ||
+                (i == count - 1 && j == 0)) {
+                continue;
+            }
+            matrix.fill_area(align[i] - 2, align[j] - 2, 5, 5);
+        }
+    }
+
+    if (version >= 7) {
+        matrix.fill_area(0, size - 11, 3, 6);
+        matrix.fill_area(size - 11, 0, 6, 3);
+    }
+}
+
+// Рисует узоры, линии синхронизации, информацию о версии и тёмный модуль
+constexpr void draw_patterns(int version, QRMatrix& out) {
+    int l = out.size();
+
+    // Добавление линий синхронизации
+    for (int i = 8; i < l - 8; i += 2) {
+        out.set(6, i);
+        out.set(i, 6);
+    }
+
+    // Создание маркеров позиционирования в углах
+    for (int i = 0; i < 7; i++) {
+        out.set(0, i);
+        out.set(6, i);
+        out.set(i, 0);
+        out.set(i, 6);
+        out.set(l - 1, i);
+        out.set(l - 7, i);
+        out.set(i, l - 1);
+        out.set(i, l - 7);
+        out.set(l - i - 1, 0);
+        out.set(l - i - 1, 6);
+        out.set(0, l - i - 1);
+        out.set(6, l - i - 1);
+    }
+
+    // Заполнение внутренних квадратов маркеров
+    out.fill_area(2, 2, 3, 3);
+    out.fill_area(l - 5, 2, 3, 3);
+    out.fill_area(2, l - 5, 3, 3);
+
+    // Выравнивающие узоры: рамка 5x5 и центральный модуль
+    std::array<int, 7> align{};
+    int count = qr_spec::alignment_positions(version, align);
+    for (int i = 0; i < count; ++i) {
+        for (int j = 0; j < count; ++j) {
+            if ((i == 0 && j == 0) || (i == 0 && j == count - 1) ||
+                (i == count - 1 && j == 0)) {
+                continue;
+            }
+            int r = align[i];
+            int c = align[j];
+            out.fill_area(r - 2, c - 2, 5, 5);
+            out.fill_area(r - 1, c - 1, 3, 3, false);
+            out.set(r, c);
+        }
+    }
+
+    // Информация о версии
+    if (version >= 7) {
+        int bits = qr_spec::version_bits(version);
+        for (int i = 0; i < 18; ++i) {
+            bool bit = (bits >> i) & 1;
+            out.set(i / 3, l - 11 + i % 3, bit);
+            out.set(l - 11 + i % 3, i / 3, bit);
+        }
+    }
+
+    // Дополнительный черный модуль
+    out.set(l - 8, 8);
+}
+
+// Вызывает visit(row, column) для модулей данных в порядке размещения:
+// пары столбцов справа налево змейкой, столбец 6 пропускается
+template <typename Visit>
+constexpr void walk_data_modules(const QRMatrix& reserved, Visit&& visit) {
+    int size = reserved.size();
+    int row_step = -1;
+    int row = size - 1;
+    int column = size - 1;
+    int index = 0;
+    while (column >= 0) {
+        if (!reserved.get(row, column)) {
+            visit(row, column);
+        }
+        if (index % 2 == 1) {
+            row += row_step;
+            if (row == -1 || row == size) {
+                row_step = -row_step;
+                row += row_step;
+                column -= column == 7 ? 2 : 1;
+            } else {
+                column += 1;
+            }
+        } else {
+            column -= 1;
+        }
+        index++;
+    }
+}
+
+// Информация о формате: уровень коррекции и маска, две копии
+constexpr void write_format(qr_spec::EccLevel level, int mask, QRMatrix& out) {
+    int size = out.size();
+    int bits = qr_spec::format_bits(level, mask);
+    for (int i = 0; i < 15; ++i) {
+        bool bit = (bits >> i) & 1;
+        if (i < 6) {
+            out.set(i, 8, bit);
+        } else if (i < 8) {
+            out.set(i + 1, 8, bit);
+        } else if (i == 8) {
+            out.set(8, 7, bit);
+        } else {
+            out.set(8, 14 - i, bit);
+        }
+        if (i < 8) {
+            out.set(8, size - 1 - i, bit);
+        } else {
+            out.set(size - 15 + i, 8, bit);
+        }
+    }
+}
+
+// Слово w строки x, сдвинутой на shift столбцов: бит j = столбец j + shift
+constexpr Word shifted(const Word* x, int stride, int w, int shift) {
+    int q = w + shift / QRMatrix::WORD_BITS;
+    int b = shift % QRMatrix::WORD_BITS;
+    Word lo = q < stride ? x[q] >> b : 0;
+    Word hi = b != 0 && q + 1 < stride ? x[q + 1] << (QRMatrix::WORD_BITS - b)
+                                       : 0;
+    return lo | hi;
+}
+
+// Правила 1 и 3 по строкам матрицы; для столбцов вызывается на
+// транспонированной. Бит j в масках ниже — окно, начинающееся в столбце j.
+constexpr int line_penalty(const QRMatrix& m) {
+    int n = m.size();
+    int stride = m.stride();
+    int score = 0;
+    for (int r = 0; r < n; ++r) {
+        const Word* x = m.row(r);
+        Word carry = 0;
+        for (int w = 0; w < stride; ++w) {
+            Word s[11] = {};
+            for (int k = 0; k < 11; ++k) s[k] = shifted(x, stride, w, k);
+
+            // Серия длины L >= 5 даёт L - 4 окон по пять одинаковых модулей;
+            // штраф 3 + (L - 5) = (L - 4) + 2 за каждое начало серии
+            Word run = (s[0] & s[1] & s[2] & s[3] & s[4]) |
+                       ~(s[0] | s[1] | s[2] | s[3] | s[4]);
+            run &= QRMatrix::span_mask(w, 0, n - 4);
+            Word starts = run & ~((run << 1) | carry);
+            carry = run >> (QRMatrix::WORD_BITS - 1);
+            score += QRMatrix::popcount(run) + 2 * QRMatrix::popcount(starts);
+
+            // 1011101 и четыре светлых модуля с любой стороны
+            Word valid = QRMatrix::span_mask(w, 0, n - 10);
+            Word light_after = ~(s[7] | s[8] | s[9] | s[10]);
+            Word light_before = ~(s[0] | s[1] | s[2] | s[3]);
+            Word finder_at0 = s[0] & ~s[1] & s[2] & s[3] & s[4] & ~s[5] & s[6];
+            Word finder_at4 =
+                s[4] & ~s[5] & s[6] & s[7] & s[8] & ~s[9] & s[10];
+            score += 40 * (QRMatrix::popcount(finder_at0 & light_after & valid) +
+                           QRMatrix::popcount(finder_at4 & light_before & valid));
+        }
+    }
+    return score;
+}
+
+// Штраф символа по четырём правилам стандарта
+constexpr int penalty(const QRMatrix& matrix) {
+    int n = matrix.size();
+    int stride = matrix.stride();
+
+    QRMatrix transposed;
+    matrix.transpose_into(transposed);
+    int score = line_penalty(matrix) + line_penalty(transposed);
+
+    // Правило 2: блоки 2x2 одного цвета
+    for (int r = 0; r + 1 < n; ++r) {
+        const Word* a = matrix.row(r);
+        const Word* b = matrix.row(r + 1);
+        for (int w = 0; w < stride; ++w) {
+            Word a0 = shifted(a, stride, w, 0);
+            Word a1 = shifted(a, stride, w, 1);
+            Word b0 = shifted(b, stride, w, 0);
+            Word b1 = shifted(b, stride, w, 1);
+            Word same = ~(a0 ^ a1) & ~(a0 ^ b0) & ~(a0 ^ b1) &
+                        QRMatrix::span_mask(w, 0, n - 1);
+            score += 3 * QRMatrix::popcount(same);
+        }
+    }
+
+    // Правило 4: отклонение доли тёмных модулей от 50% с шагом 5%
+    int total = n * n;
+    int dark = matrix.count_dark();
+    int deviation = dark * 20 - total * 10;
+    if (deviation < 0) deviation = -deviation;
+    score += 10 * (deviation / total);
+    return score;
+}
+
+}  // namespace qr_layout
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Упакованная матрица модулей: строка хранится в stride() 64-битных словах,
+// модуль (row, column) — бит column % 64 слова row * stride() + column / 64.
+class QRMatrix {
+   public:
+    using Word = uint64_t;
+    static const int WORD_BITS = 64;
+    static const int MAX_SIZE = 177;  // версия 40
+    static const int MAX_STRIDE = (MAX_SIZE + WORD_BITS - 1) / WORD_BITS;
+
+    constexpr QRMatrix() : size_(0), stride_(0), words_{} {}
+    constexpr explicit QRMatrix(int size) : QRMatrix() { reset(size); }
+
+    constexpr void reset(int size) {
+        size_ = size;
+        stride_ = (size + WORD_BITS - 1) / WORD_BITS;
+        for (size_t i = 0; i < word_count(); ++i) words_[i] = 0;
+    }
+
+    // Копирует только используемые слова
+    constexpr void copy_from(const QRMatrix& other) {
+        size_ = other.size_;
+        stride_ = other.stride_;
+        for (size_t i = 0; i < word_count(); ++i) words_[i] = other.words_[i];
+    }
+
+    constexpr int size() const { return size_; }
+    constexpr int stride() const { return stride_; }
+    constexpr size_t word_count() const {
+        return static_cast<size_t>(size_) * stride_;
+    }
+
+    constexpr Word* row(int r) { return &words_[r * stride_]; }
+    constexpr const Word* row(int r) const { return &words_[r * stride_]; }
+    constexpr Word* data() { return words_.data(); }
+    constexpr const Word* data() const { return words_.data(); }
+
+    constexpr bool get(int r, int c) const {
+        return (row(r)[c / WORD_BITS] >> (c % WORD_BITS)) & 1;
+    }
+    constexpr void set(int r, int c, bool value = true) {
+        Word bit = Word(1) << (c % WORD_BITS);
+        Word& w = row(r)[c / WORD_BITS];
+        w = value ? (w | bit) : (w & ~bit);
+    }
+    constexpr void flip(int r, int c) {
+        row(r)[c / WORD_BITS] ^= Word(1) << (c % WORD_BITS);
+    }
+
+    // Маска битов [column, column + width) внутри слова word строки
+    static constexpr Word span_mask(int word, int column, int width) {
+        int lo = column - word * WORD_BITS;
+        int hi = lo + width;
+        if (lo < 0) lo = 0;
+        if (hi > WORD_BITS) hi = WORD_BITS;
+        if (lo >= hi) return 0;
+        Word upper = hi == WORD_BITS ? ~Word(0) : (Word(1) << hi) - 1;
+        return upper & ~((Word(1) << lo) - 1);
+    }
+
+    // Закрашивает прямоугольник целыми словами
+    constexpr void fill_area(int r, int c, int width, int height,
+                             bool value = true) {
+        int first = c / WORD_BITS;
+        int last = (c + width - 1) / WORD_BITS;
+        for (int i = r; i < r + height; ++i) {
+            Word* line = row(i);
+            for (int w = first; w <= last; ++w) {
+                Word m = span_mask(w, c, width);
+                line[w] = value ? (line[w] | m) : (line[w] & ~m);
+            }
+        }
+    }
+
+    static constexpr int popcount(Word w) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_popcountll(w);
+#else
+        int count = 0;
+        for (; w; w &= w - 1) ++count;
+        return count;
+#endif
+    }
+
+    // Номер младшего единичного бита, w != 0
+    static constexpr int lowest_bit(Word w) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(w);
+#else
+        int index = 0;
+        for (; !(w & 1); w >>= 1) ++index;
+        return index;
+#endif
+    }
+
+    // Первый столбец строки row не левее column со значением value или
+    // size(); слова без нужных битов пропускаются целиком
+    constexpr int find_next(int r, int column, bool value) const {
+        const Word* line = row(r);
+        while (column < size_) {
+            int w = column / WORD_BITS;
+            Word bits = value ? line[w] : ~line[w];
+            bits &= ~Word(0) << (column % WORD_BITS);
+            if (bits) {
+                int found = w * WORD_BITS + lowest_bit(bits);
+                return found < size_ ? found : size_;
+            }
+            column = (w + 1) * WORD_BITS;
+        }
+        return size_;
+    }
+
+    constexpr int count_dark() const {
+        int count = 0;
+        for (size_t i = 0; i < word_count(); ++i) count += popcount(words_[i]);
+        return count;
+    }
+
+    // Транспонирование блоками 64x64 обменом половин (Hacker's Delight)
+    constexpr void transpose_into(QRMatrix& out) const {
+        out.reset(size_);
+        for (int br = 0; br < stride_; ++br) {
+            for (int bc = 0; bc < stride_; ++bc) {
+                Word a[WORD_BITS] = {};
+                for (int i = 0; i < WORD_BITS; ++i) {
+                    int r = br * WORD_BITS + i;
+                    if (r < size_) a[i] = row(r)[bc];
+                }
+                transpose64(a);
+                for (int i = 0; i < WORD_BITS; ++i) {
+                    int r = bc * WORD_BITS + i;
+                    if (r < size_) out.row(r)[br] = a[i];
+                }
+            }
+        }
+    }
+
+    constexpr bool operator==(const QRMatrix& other) const {
+        if (size_ != other.size_) return false;
+        for (size_t i = 0; i < word_count(); ++i) {
+            if (words_[i] != other.words_[i]) return false;
+        }
+        return true;
+    }
+    constexpr bool operator!=(const QRMatrix& other) const {
+        return !(*this == other);
+    }
+
+   private:
+    static constexpr void transpose64(Word* a) {
+        Word m = 0x00000000FFFFFFFFull;
+        for (int j = 32; j != 0; j >>= 1, m ^= m << j) {
+            for (int k = 0; k < WORD_BITS; k = ((k | j) + 1) & ~j) {
+                Word t = ((a[k] >> j) ^ a[k | j]) & m;
+                a[k] ^= t << j;
+                a[k | j] ^= t;
+            }
+        }
+    }
+
+    int size_;
+    int stride_;
+    std::array<Word, MAX_SIZE * MAX_STRIDE> words_;
+};
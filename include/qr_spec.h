@@ -0,0 +1,190 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// Параметры символов QR по ISO/IEC 18004: размеры версий, уровни
+// коррекции, раскладка блоков Рида — Соломона, служебные биты
+namespace qr_spec {
+
+enum class EccLevel { L = 0, M = 1, Q = 2, H = 3 };
+
+constexpr int MIN_VERSION = 1;
+constexpr int MAX_VERSION = 40;
+
+// ECC-байтов в блоке и число блоков по уровню (L, M, Q, H) и версии
+constexpr int8_t ECC_CODEWORDS_PER_BLOCK[4][41] = {
+    {-1, 7,  10, 15, 20, 26, 18, 20, 24, 30, 18, 20, 24, 26, 30,
+     22, 24, 28, 30, 28, 28, 28, 28, 30, 30, 26, 28, 30, 30, 30,
+     30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30},
+    {-1, 10, 16, 26, 18, 24, 16, 18, 22, 22, 26, 30, 22, 22, 24,
+     24, 28, 28, 26, 26, 26, 26, 28, 28, 28, 28, 28, 28, 28, 28,
+     28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28},
+    {-1, 13, 22, 18, 26, 18, 24, 18, 22, 20, 24, 28, 26, 24, 20,
+     30, 24, 28, 28, 26, 30, 28, 30, 30, 30, 30, 28, 30, 30, 30,
+     30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30},
+    {-1, 17, 28, 22, 16, 22, 28, 26, 26, 24, 28, 24, 28, 22, 24,
+     24, 30, 28, 28, 26, 28, 30, 24, 30, 30, 30, 30, 30, 30, 30,
+     30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30}};
+
+constexpr int8_t NUM_BLOCKS[4][41] = {
+    {-1, 1,  1,  1,  1,  1,  2,  2,  2,  2,  4,  4,  4,  4,  4,
+     6,  6,  6,  6,  7,  8,  8,  9,  9,  10, 12, 12, 12, 13, 14,
+     15, 16, 17, 18, 19, 19, 20, 21, 22, 24, 25},
+    {-1, 1,  1,  1,  2,  2,  4,  4,  4,  5,  5,  5,  8,  9,  9,
+     10, 10, 11, 13, 14, 16, 17, 17, 18, 20, 21, 23, 25, 26, 28,
+     29, 31, 33, 35, 37, 38, 40, 43, 45, 47, 49},
+    {-1, 1,  1,  2,  2,  4,  4,  6,  6,  8,  8,  8,  10, 12, 16,
+     12, 17, 16, 18, 21, 20, 23, 23, 25, 27, 29, 34, 34, 35, 38,
+     40, 43, 45, 48, 51, 53, 56, 59, 62, 65, 68},
+    {-1, 1,  1,  2,  4,  4,  4,  5,  6,  8,  8,  11, 11, 16, 16,
+     18, 16, 19, 21, 25, 25, 25, 34, 30, 32, 35, 37, 40, 42, 45,
+     48, 51, 54, 57, 60, 63, 66, 70, 74, 77, 81}};
+
+constexpr int symbol_size(int version) { return 17 + 4 * version; }
+
+// Число модулей под данные и ECC (включая остаточные биты)
+constexpr int raw_data_modules(int version) {
+    int result = (16 * version + 128) * version + 64;
+    if (version >= 2) {
+        int align = version / 7 + 2;
+        result -= (25 * align - 10) * align - 55;
+        if (version >= 7) result -= 36;
+    }
+    return result;
+}
+
+constexpr int total_codewords(int version) {
+    return raw_data_modules(version) / 8;
+}
+
+constexpr int ecc_codewords_per_block(int version, EccLevel level) {
+    return ECC_CODEWORDS_PER_BLOCK[static_cast<int>(level)][version];
+}
+
+constexpr int num_blocks(int version, EccLevel level) {
+    return NUM_BLOCKS[static_cast<int>(level)][version];
+}
+
+constexpr int data_codewords(int version, EccLevel level) {
+    return total_codewords(version) -
+           ecc_codewords_per_block(version, level) * num_blocks(version, level);
+}
+
+constexpr int MAX_DATA_CODEWORDS = data_codewords(MAX_VERSION, EccLevel::L);
+constexpr int MAX_TOTAL_CODEWORDS = total_codewords(MAX_VERSION);
+
+// Версия по полному числу кодовых слов символа, 0 если такой нет
+constexpr int version_for_codewords(int total) {
+    for (int v = MIN_VERSION; v <= MAX_VERSION; ++v) {
+        if (total_codewords(v) == total) return v;
+    }
+    return 0;
+}
+
+// Раскладка блоков: первые short_blocks блоков содержат short_data байтов
+// данных, остальные — на один больше. Данные блоков идут подряд в порядке
+// номеров, в символе байты перемежаются по столбцам.
+struct BlockLayout {
+    int blocks = 0;
+    int short_blocks = 0;
+    int short_data = 0;
+    int ecc = 0;
+    int data_codewords = 0;
+    int total_codewords = 0;
+
+    constexpr int data_length(int block) const {
+        return short_data + (block >= short_blocks ? 1 : 0);
+    }
+    constexpr int data_offset(int block) const {
+        return block * short_data +
+               (block > short_blocks ? block - short_blocks : 0);
+    }
+    // Позиция i-го байта данных блока в перемежённой последовательности
+    constexpr int data_position(int block, int i) const {
+        return i < short_data ? i * blocks + block
+                              : short_data * blocks + block - short_blocks;
+    }
+    constexpr int ecc_position(int block, int j) const {
+        return data_codewords + j * blocks + block;
+    }
+    // Обратное отображение: блок и индекс байта внутри блока (данные, ECC)
+    constexpr void locate(int pos, int& block, int& index) const {
+        if (pos >= data_codewords) {
+            block = (pos - data_codewords) % blocks;
+            index = data_length(block) + (pos - data_codewords) / blocks;
+        } else if (pos < short_data * blocks) {
+            block = pos % blocks;
+            index = pos / blocks;
+        } else {
+            block = short_blocks + pos - short_data * blocks;
+            index = short_data;
+        }
+    }
+};
+
+constexpr BlockLayout block_layout(int version, EccLevel level) {
+    BlockLayout layout;
+    layout.blocks = num_blocks(version, level);
+    layout.ecc = ecc_codewords_per_block(version, level);
+    layout.total_codewords = total_codewords(version);
+    layout.data_codewords = data_codewords(version, level);
+    layout.short_blocks =
+        layout.blocks - layout.total_codewords % layout.blocks;
+    layout.short_data = layout.total_codewords / layout.blocks - layout.ecc;
+    return layout;
+}
+
+// Центры выравнивающих узоров; возвращает их число
+constexpr int alignment_positions(int version, std::array<int, 7>& out) {
+    if (version == 1) return 0;
+    int count = version / 7 + 2;
+    int step = version == 32
+                   ? 26
+                   : (version * 4 + count * 2 + 1) / (count * 2 - 2) * 2;
+    out[0] = 6;
+    for (int i = count - 1, pos = symbol_size(version) - 7; i >= 1;
+         --i, pos -= step) {
+        out[i] = pos;
+    }
+    return count;
+}
+
+// 15 бит информации о формате: уровень и маска, код БЧХ и маска 0x5412
+constexpr int format_bits(EccLevel level, int mask) {
+    constexpr int LEVEL_BITS[4] = {1, 0, 3, 2};
+    int data = LEVEL_BITS[static_cast<int>(level)] << 3 | mask;
+    int rem = data;
+    for (int i = 0; i < 10; ++i) rem = (rem << 1) ^ ((rem >> 9) * 0x537);
+    return (data << 10 | rem) ^ 0x5412;
+}
+
+// 18 бит информации о версии (только для версий 7 и выше)
+constexpr int version_bits(int version) {
+    int rem = version;
+    for (int i = 0; i < 12; ++i) rem = (rem << 1) ^ ((rem >> 11) * 0x1F25);
+    return version << 12 | rem;
+}
+
+// Режимы сегментов; значение — 4-битный индикатор режима
+enum class Mode { NUMERIC = 0x1, ALPHANUMERIC = 0x2, BYTE = 0x4 };
+
+// Длина поля счётчика символов по режиму и группе версий (1-9, 10-26, 27-40)
+constexpr int count_bits(Mode mode, int version) {
+    int group = version < 10 ? 0 : version < 27 ? 1 : 2;
+    switch (mode) {
+        case Mode::NUMERIC:
+            return 10 + 2 * group;
+        case Mode::ALPHANUMERIC:
+            return 9 + 2 * group;
+        case Mode::BYTE:
+            return group == 0 ? 8 : 16;
+    }
+    return 0;
+}
+
+constexpr int byte_count_bits(int version) {
+    return count_bits(Mode::BYTE, version);
+}
+
+}  // namespace qr_spec
@@ -0,0 +1,94 @@
+#pragma once
+
+/* C-интерфейс библиотеки qrcode для вызова из других языков (ctypes, cgo).
+ * Внутренние классы наружу не выходят: структуры ниже имеют фиксированную
+ * раскладку, исключения ловятся на границе и превращаются в коды qrc_status.
+ * Функции потокобезопасны, состояние между вызовами не хранится. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define QRC_ABI_VERSION 1
+
+/* Библиотека собирается со скрытой видимостью символов; экспортируются
+ * только функции, помеченные QRC_API */
+#if defined(__GNUC__) || defined(__clang__)
+#define QRC_API __attribute__((visibility("default")))
+#else
+#define QRC_API
+#endif
+
+typedef enum qrc_status {
+    QRC_OK = 0,
+    QRC_INVALID_ARGUMENT = 1,
+    QRC_ENCODE_FAILED = 2,  /* сообщение не помещается ни в одну версию */
+    QRC_BUFFER_TOO_SMALL = 3,
+    QRC_INTERNAL_ERROR = 4
+} qrc_status;
+
+typedef enum qrc_level {
+    QRC_LEVEL_L = 0,
+    QRC_LEVEL_M = 1,
+    QRC_LEVEL_Q = 2,
+    QRC_LEVEL_H = 3
+} qrc_level;
+
+typedef enum qrc_format {
+    QRC_FORMAT_MODULES = 0, /* size * size байтов по строкам, 1 — тёмный */
+    QRC_FORMAT_PPM = 1,
+    QRC_FORMAT_PBM = 2,
+    QRC_FORMAT_SVG = 3
+} qrc_format;
+
+typedef struct qrc_options {
+    int32_t level;      /* qrc_level */
+    int32_t format;     /* qrc_format */
+    int32_t mask;       /* 0..7 или -1 — по наименьшему штрафу */
+    int32_t scale;      /* пикселей на модуль для изображений */
+    int32_t quiet_zone; /* светлая рамка в модулях для изображений */
+} qrc_options;
+
+/* Итог одного сообщения; байты лежат в arena[offset, offset + length) */
+typedef struct qrc_result {
+    uint64_t offset;
+    uint64_t length; /* при QRC_BUFFER_TOO_SMALL — сколько было нужно */
+    int32_t status;  /* qrc_status */
+    int32_t version;
+    int32_t size;    /* сторона символа в модулях */
+    int32_t mask;
+} qrc_result;
+
+/* Версия ABI, с которой собрана библиотека (QRC_ABI_VERSION) */
+QRC_API int32_t qrc_abi_version(void);
+
+/* Уровень L, модули, автоматическая маска, масштаб 10, без рамки */
+QRC_API void qrc_default_options(qrc_options* options);
+
+/* Кодирует count сообщений payloads[i] длины lengths[i] одним вызовом.
+ * Результаты пишутся в arena подряд в порядке сообщений, results[i]
+ * описывает i-е. Ошибка одного сообщения не прерывает остальные. Если
+ * arena мала, не поместившиеся сообщения получают QRC_BUFFER_TOO_SMALL,
+ * а *required (если не NULL) — размер арены, достаточный для всей пачки.
+ * Возвращает QRC_OK, QRC_BUFFER_TOO_SMALL или QRC_INVALID_ARGUMENT. */
+QRC_API int32_t qrc_encode_batch(const char* const* payloads,
+                                 const size_t* lengths, size_t count,
+                                 const qrc_options* options, uint8_t* arena,
+                                 size_t arena_size, qrc_result* results,
+                                 size_t* required);
+
+/* Одно сообщение: то же, что пачка из одного элемента; возвращает
+ * статус сообщения */
+QRC_API int32_t qrc_encode(const char* payload, size_t length,
+                           const qrc_options* options, uint8_t* out,
+                           size_t capacity, qrc_result* result);
+
+/* Английское описание статуса */
+QRC_API const char* qrc_status_string(int32_t status);
+
+#ifdef __cplusplus
+}
+#endif
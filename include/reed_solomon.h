@@ -1,56 +1,102 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <string>
 #include <vector>
 
+#include "gf256.h"
+#include "gf256_region.h"
+#include "qr_spec.h"
+#include "segment.h"
+
 class ReedSolomon {
    public:
-    using Code = std::vector<int>;
-    static const int CORRECTION_SYMBOL_COUNT = 7;
-    static const int PRIMITIVE = 0x11d;
+    using Code = std::vector<uint8_t>;
+    using EccLevel = qr_spec::EccLevel;
+    // Максимум ECC-байтов в блоке QR
+    static const int MAX_ECC_LENGTH = gf256::MAX_GENERATOR_DEGREE;
+    static const int PRIMITIVE = gf256::PRIMITIVE;
+
+    ReedSolomon() = default;
+
+    // Итог исправления блока
+    struct DecodeResult {
+        bool ok = false;   // блок без ошибок или успешно исправлен
+        int errors = 0;    // исправленные ошибки в неизвестных позициях
+        int erasures = 0;  // стирания в известных позициях
+    };
+
+    // Кодирует сообщение в наименьшую подходящую версию с уровнем level и
+    // возвращает все кодовые слова символа (данные и ECC, перемежённые)
+    Code encode(std::string message, EccLevel level = EccLevel::L);
+    // Символ набора Structured Append: header пишется перед сегментами
+    Code encode(const std::string& message, EccLevel level,
+                const qr_segment::AppendHeader& header);
+    // Заголовок Structured Append, если он есть в символе, пишется в append
+    std::string decode(Code code, EccLevel level = EccLevel::L,
+                       std::vector<int> erase_pos = {},
+                       DecodeResult* stats = nullptr,
+                       qr_segment::AppendHeader* append = nullptr);
+
+    // Наименьшая версия, вмещающая оптимальное разбиение message на
+    // числовые, буквенно-цифровые и байтовые сегменты; structured_append
+    // оставляет место под заголовок части набора
+    static int choose_version(const std::string& message, EccLevel level,
+                              std::vector<qr_segment::Segment>* segments =
+                                  nullptr,
+                              bool structured_append = false);
 
-    ReedSolomon();
+    // Раскладывает данные data (data_codewords байтов) по блокам версии,
+    // добавляет ECC и пишет перемежённую последовательность в out
+    void encode_message(const uint8_t* data, int version, EccLevel level,
+                        uint8_t* out) const;
+    // То же для одного блока: блоки пишут в непересекающиеся позиции out,
+    // поэтому большие символы можно кодировать по блокам параллельно
+    void encode_message_block(const uint8_t* data, int version,
+                              EccLevel level, int block, uint8_t* out) const;
 
-    Code encode(std::string message);
-    std::string decode(Code code, std::vector<int> erase_pos = {});
+    // Записывает nsym корректирующих байтов блока data[0..n) в ecc_out.
+    // Остаток считается векторным ядром gf256::rs_remainder, память не
+    // выделяется.
+    void encode_block(const uint8_t* data, size_t n, int nsym,
+                      uint8_t* ecc_out) const;
+
+    // Исправляет блок msg[0..n) из данных и nsym ECC-байтов на месте.
+    // Работает в буферах фиксированного размера на стеке и сразу выходит,
+    // если все синдромы нулевые.
+    DecodeResult decode_block(uint8_t* msg, size_t n, int nsym,
+                              const int* erase_pos = nullptr,
+                              int erase_count = 0) const;
 
    private:
-    std::vector<int> gf_log_;  // Логарифмическая таблица
-    std::vector<int> gf_exp_;  // Экспоненциальная таблица
-
-    void init_tables();
-    int gf_mult_noLUT(int x, int y);
-
-    std::vector<int> encode_message(const std::vector<int>& msg_in);
-    std::pair<std::vector<int>, std::vector<int>> decode_message(
-        std::vector<int> msg_in, const std::vector<int>& erase_pos);
-    Code get_code(std::string message);
-    std::vector<int> generator_poly();
-
-    int gf_mul(int x, int y);
-    int gf_div(int x, int y);
-    int gf_pow(int x, int power);
-    int gf_inverse(int x);
-    int gf_poly_eval(const std::vector<int>& poly, int x);
-    std::vector<int> gf_poly_add(const std::vector<int>& p,
-                                 const std::vector<int>& q);
-    std::vector<int> gf_poly_scale(const std::vector<int>& p, int x);
-    std::vector<int> gf_poly_mul(const std::vector<int>& p,
-                                 const std::vector<int>& q);
-    std::pair<std::vector<int>, std::vector<int>> gf_poly_div(
-        const std::vector<int>& dividend, const std::vector<int>& divisor);
-
-    std::vector<int> calc_syndromes(const std::vector<int>& msg);
-    std::vector<int> find_errors_locator(const std::vector<int>& e_pos);
-    std::vector<int> find_error_evaluator(const std::vector<int>& synd,
-                                             const std::vector<int>& err_loc,
-                                             int nsym);
-    std::vector<int> find_error_locator(const std::vector<int>& synd,
-                                           int erase_count = 0);
-    std::vector<int> find_errors(const std::vector<int>& err_loc, int nmess);
-    std::vector<int> forney_syndromes(const std::vector<int>& synd,
-                                         const std::vector<int>& pos,
-                                         int nmess);
-    std::vector<int> correct_errata(std::vector<int> msg_in,
-                                       const std::vector<int>& synd,
-                                       const std::vector<int>& err_pos);
+    // Отдельные этапы конвейера для qr_bench и EncoderSession
+    friend struct PipelineStages;
+    friend class EncoderSession;
+
+    static const int SCRATCH_SIZE = 2 * MAX_ECC_LENGTH + 2;
+
+    Code encode_symbol(const std::string& message, EccLevel level,
+                       const qr_segment::AppendHeader* header);
+
+    // Собирает кодовые слова данных (data_codewords байтов) в out
+    static void get_code(const std::string& message,
+                         const std::vector<qr_segment::Segment>& segments,
+                         int version, EccLevel level, uint8_t* out,
+                         const qr_segment::AppendHeader* header = nullptr);
+
+    static bool calc_syndromes(const uint8_t* msg, size_t n, int nsym,
+                               uint8_t* synd);
+    static int find_errors_locator(const int* pos, int count, size_t n,
+                                   uint8_t* loc);
+    static void forney_syndromes(const uint8_t* synd, int nsym,
+                                 const uint8_t* erase_loc, int erase_count,
+                                 uint8_t* fsynd);
+    static int find_error_locator(const uint8_t* synd, int count,
+                                  uint8_t* err_loc);
+    static int find_errors(const uint8_t* loc, int degree, size_t n,
+                           int* pos);
+    static bool correct_errata(uint8_t* msg, size_t n, const uint8_t* synd,
+                               int nsym, const uint8_t* loc, int degree,
+                               const int* pos, int count);
 };
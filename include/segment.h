@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "bit_writer.h"
+#include "qr_spec.h"
+#include "segment_core.h"
+
+// Сегменты данных QR: числовой, буквенно-цифровой и байтовый режимы и
+// разбиение сообщения на сегменты с минимальной длиной битового потока
+namespace qr_segment {
+
+// Structured Append: сообщение делится на символы (до 16), перед
+// сегментами каждого идёт заголовок — индикатор 0011, номер символа и их
+// число минус один по 4 бита и 8 бит чётности (XOR всех байтов полного
+// сообщения)
+constexpr uint32_t APPEND_MODE = 0x3;
+constexpr size_t APPEND_HEADER_BITS = 20;
+constexpr int MAX_APPEND_SYMBOLS = 16;
+
+struct AppendHeader {
+    int index = 0;
+    int total = 0;  // 0 — символ не входит в набор
+    uint8_t parity = 0;
+};
+
+// Записывает класс каждого байта data[0..n) в classes и возвращает
+// побитовое И классов всех байтов. Основной цикл идёт по 16 байтов
+// сравнениями SSE2, хвост и другие платформы — по таблице.
+uint8_t classify(const uint8_t* data, size_t n, uint8_t* classes);
+
+// Оптимальное разбиение по классам байтов сообщения для группы версий,
+// к которой относится version (plan_segments из segment_core.h).
+// Динамика по трём режимам за один проход, длины считаются в шестых
+// долях бита. Возвращает длину потока в битах или SIZE_MAX.
+size_t plan(const uint8_t* classes, size_t n, int version,
+            std::vector<Segment>& out);
+
+// Наименьшая версия, в которую помещается оптимальное разбиение сообщения
+// с уровнем level и reserved_bits битами перед ним (заголовок Structured
+// Append); разбиение пишется в segments
+int choose_version(const uint8_t* data, size_t n, qr_spec::EccLevel level,
+                   std::vector<Segment>& segments, size_t reserved_bits = 0);
+
+uint8_t append_parity(const uint8_t* data, size_t n);
+void write_append_header(BitWriter& writer, const AppendHeader& header);
+
+// Записывает сегменты сообщения data в поток без терминатора
+void write(BitWriter& writer, const uint8_t* data,
+           const std::vector<Segment>& segments, int version);
+
+// Разбирает сегменты из кодовых слов данных до терминатора или конца;
+// заголовок Structured Append, если он есть, пишется в append
+std::string parse(const uint8_t* data, size_t n, int version,
+                  AppendHeader* append = nullptr);
+
+}  // namespace qr_segment
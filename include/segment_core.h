@@ -0,0 +1,220 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+#include "qr_spec.h"
+
+// Разбиение сообщения на сегменты без привязки к контейнерам: таблицы
+// символов, длины сегментов, динамика по трём режимам, выбор версии и
+// запись сегментов в битовый поток. Все функции constexpr, поэтому одним
+// кодом пользуются qr_segment во время выполнения и qr::make на этапе
+// компиляции.
+namespace qr_segment {
+
+using Mode = qr_spec::Mode;
+
+// Классы байтов: цифры годятся и для буквенно-цифрового режима, любой
+// байт — для байтового
+constexpr uint8_t CLASS_NUMERIC = 1;
+constexpr uint8_t CLASS_ALPHANUMERIC = 2;
+
+constexpr char ALPHANUMERIC_CHARS[] =
+    "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ $%*+-./:";
+
+struct CharTables {
+    std::array<int8_t, 256> value{};
+    std::array<uint8_t, 256> cls{};
+};
+
+constexpr CharTables make_char_tables() {
+    CharTables t;
+    for (int c = 0; c < 256; ++c) t.value[c] = -1;
+    for (int i = 0; i < 45; ++i) {
+        uint8_t c = static_cast<uint8_t>(ALPHANUMERIC_CHARS[i]);
+        t.value[c] = static_cast<int8_t>(i);
+        t.cls[c] = i < 10 ? CLASS_NUMERIC | CLASS_ALPHANUMERIC
+                          : CLASS_ALPHANUMERIC;
+    }
+    return t;
+}
+
+inline constexpr CharTables CHARS = make_char_tables();
+
+constexpr Mode MODES[3] = {Mode::NUMERIC, Mode::ALPHANUMERIC, Mode::BYTE};
+constexpr uint8_t MODE_CLASS[3] = {CLASS_NUMERIC, CLASS_ALPHANUMERIC, 0};
+constexpr uint32_t CHAR_COST[3] = {20, 33, 48};  // шестые доли бита
+
+// Представительная версия каждой группы длин счётчика
+constexpr int GROUP_LAST[3] = {9, 26, 40};
+
+struct Segment {
+    Mode mode = Mode::BYTE;
+    size_t offset = 0;  // начало сегмента в сообщении
+    size_t length = 0;  // число символов
+};
+
+// Значение символа в буквенно-цифровом режиме, -1 если символа нет
+constexpr int alphanumeric_value(uint8_t c) { return CHARS.value[c]; }
+
+// Длина сегмента в битах с индикатором режима и счётчиком; SIZE_MAX, если
+// длина не помещается в поле счётчика версии
+constexpr size_t segment_bits(Mode mode, size_t length, int version) {
+    int count = qr_spec::count_bits(mode, version);
+    if (length >= (size_t(1) << count)) return SIZE_MAX;
+    size_t bits = 4 + count;
+    switch (mode) {
+        case Mode::NUMERIC:
+            bits += 10 * (length / 3) +
+                    (length % 3 == 0 ? 0 : 3 * (length % 3) + 1);
+            break;
+        case Mode::ALPHANUMERIC:
+            bits += 11 * (length / 2) + 6 * (length % 2);
+            break;
+        case Mode::BYTE:
+            bits += 8 * length;
+            break;
+    }
+    return bits;
+}
+
+// Сумма длин сегментов или SIZE_MAX, если какой-то не помещается
+constexpr size_t segments_bits(const Segment* segments, size_t count,
+                               int version) {
+    size_t bits = 0;
+    for (size_t s = 0; s < count; ++s) {
+        size_t b = segment_bits(segments[s].mode, segments[s].length, version);
+        if (b == SIZE_MAX) return SIZE_MAX;
+        bits += b;
+    }
+    return bits;
+}
+
+// Оптимальное разбиение по классам байтов classes[0..n) для группы
+// версий, к которой относится version. from — рабочий буфер на 3n байтов,
+// out — место для max(n, 1) сегментов. Возвращает число сегментов.
+constexpr size_t plan_segments(const uint8_t* classes, size_t n, int version,
+                               uint8_t* from, Segment* out) {
+    if (n == 0) {
+        // Пустое сообщение — один пустой байтовый сегмент
+        out[0] = Segment{};
+        return 1;
+    }
+
+    // cost[j] — наименьшая длина префикса, после которого следующий символ
+    // кодируется в режиме j (заголовок его сегмента уже учтён). from[i][j] —
+    // режим символа i на этом пути.
+    uint32_t head[3] = {};
+    for (int j = 0; j < 3; ++j) {
+        head[j] = (4 + qr_spec::count_bits(MODES[j], version)) * 6;
+    }
+    uint32_t cost[3] = {head[0], head[1], head[2]};
+    const uint32_t INF = UINT32_MAX / 2;
+
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t end[3] = {};
+        for (int k = 0; k < 3; ++k) {
+            bool fits = (classes[i] & MODE_CLASS[k]) == MODE_CLASS[k];
+            end[k] = fits && cost[k] < INF ? cost[k] + CHAR_COST[k] : INF;
+        }
+        uint8_t* row = from + i * 3;
+        for (int j = 0; j < 3; ++j) {
+            cost[j] = end[j];
+            row[j] = static_cast<uint8_t>(j);
+            for (int k = 0; k < 3; ++k) {
+                if (k == j || end[k] >= INF) continue;
+                uint32_t switched = (end[k] + 5) / 6 * 6 + head[j];
+                if (switched < cost[j]) {
+                    cost[j] = switched;
+                    row[j] = static_cast<uint8_t>(k);
+                }
+            }
+        }
+    }
+
+    // Восстановление с конца: соседние символы одного режима — один
+    // сегмент; затем разворот порядка сегментов
+    int mode = 0;
+    for (int j = 1; j < 3; ++j) {
+        if (cost[j] < cost[mode]) mode = j;
+    }
+    size_t count = 0;
+    for (size_t i = n; i-- > 0;) {
+        mode = from[i * 3 + mode];
+        if (count == 0 || out[count - 1].mode != MODES[mode]) {
+            out[count++] = Segment{MODES[mode], i, 0};
+        }
+        out[count - 1].offset = i;
+        ++out[count - 1].length;
+    }
+    for (size_t a = 0, b = count - 1; a < b; ++a, --b) {
+        Segment t = out[a];
+        out[a] = out[b];
+        out[b] = t;
+    }
+    return count;
+}
+
+// Наименьшая версия для уровня level, в которую помещается поток из
+// reserved_bits битов и разбиения group_bits(last) — длины в битах
+// разбиения для группы версий с последней версией last или SIZE_MAX
+template <class GroupBits>
+constexpr int smallest_version(qr_spec::EccLevel level, size_t reserved_bits,
+                               GroupBits group_bits) {
+    int first = qr_spec::MIN_VERSION;
+    for (int last : GROUP_LAST) {
+        size_t bits = group_bits(last);
+        if (bits != SIZE_MAX) bits += reserved_bits;
+        for (int v = first; bits != SIZE_MAX && v <= last; ++v) {
+            if (bits <= size_t(qr_spec::data_codewords(v, level)) * 8) {
+                return v;
+            }
+        }
+        first = last + 1;
+    }
+    throw std::runtime_error("Message too long");
+}
+
+// Записывает сегменты сообщения data в поток без терминатора. Writer —
+// битовый поток с append(value, count) и append_bytes(data, n).
+template <class Writer>
+constexpr void write_segments(Writer& writer, const uint8_t* data,
+                              const Segment* segments, size_t count,
+                              int version) {
+    for (size_t s = 0; s < count; ++s) {
+        const Segment& seg = segments[s];
+        const uint8_t* p = data + seg.offset;
+        writer.append(static_cast<uint32_t>(seg.mode), 4);
+        writer.append(static_cast<uint32_t>(seg.length),
+                      qr_spec::count_bits(seg.mode, version));
+        size_t i = 0;
+        switch (seg.mode) {
+            case Mode::NUMERIC:
+                for (; i + 3 <= seg.length; i += 3) {
+                    writer.append((p[i] - '0') * 100 + (p[i + 1] - '0') * 10 +
+                                      (p[i + 2] - '0'),
+                                  10);
+                }
+                if (seg.length - i == 2) {
+                    writer.append((p[i] - '0') * 10 + (p[i + 1] - '0'), 7);
+                } else if (seg.length - i == 1) {
+                    writer.append(p[i] - '0', 4);
+                }
+                break;
+            case Mode::ALPHANUMERIC:
+                for (; i + 2 <= seg.length; i += 2) {
+                    writer.append(
+                        CHARS.value[p[i]] * 45 + CHARS.value[p[i + 1]], 11);
+                }
+                if (i < seg.length) writer.append(CHARS.value[p[i]], 6);
+                break;
+            case Mode::BYTE:
+                writer.append_bytes(p, seg.length);
+                break;
+        }
+    }
+}
+
+}  // namespace qr_segment
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Долгоживущий сервис кодирования на Unix-сокете или локальном TCP.
+//
+// Кадр запроса: 4 байта длины (big-endian) остатка кадра, затем
+//   id (4 байта, big-endian), уровень ECC (0..3 — L, M, Q, H),
+//   формат (0 — PPM, 1 — PBM, 2 — SVG), масштаб (1..255), рамка (0..255),
+//   данные.
+// Кадр ответа: 4 байта длины остатка, затем
+//   id, статус (Status), версия, маска, формат, тело — байты изображения
+//   или текст ошибки.
+//
+// Клиент может отправлять запросы, не дожидаясь ответов. Кадры, прочитанные
+// из соединения одним вызовом, образуют пакет и обрабатываются одним рабочим
+// потоком; ответы пакета уходят одним sendmsg в порядке запросов. Пакеты
+// одного соединения могут завершиться в любом порядке, ответ находят по id.
+namespace server {
+
+enum Status : uint8_t {
+    OK = 0,
+    BAD_REQUEST = 1,    // неверные поля; на слишком длинный кадр
+                        // соединение закрывается
+    ENCODE_FAILED = 2,  // сообщение не помещается или изображение велико
+};
+
+constexpr size_t REQUEST_HEADER_SIZE = 8;   // после поля длины
+constexpr size_t RESPONSE_HEADER_SIZE = 8;  // после поля длины
+constexpr size_t MAX_PAYLOAD = 4096;
+constexpr int MAX_IMAGE_SIDE = 4096;  // пикселей вместе с рамкой
+
+struct ServerOptions {
+    std::string address;      // путь сокета, "unix:ПУТЬ" или "tcp:ПОРТ"
+    int threads = 0;          // 0 — по числу ядер
+    size_t max_batch = 64;    // запросов в одном пакете
+    size_t cache_bytes = 0;   // бюджет общего кэша символов, 0 — без кэша
+};
+
+struct ServerStats {
+    uint64_t connections = 0;
+    uint64_t requests = 0;
+    uint64_t failed = 0;
+    uint64_t batches = 0;
+};
+
+// Обслуживает соединения до SIGINT или SIGTERM, затем дожидается ответов
+// на уже принятые запросы
+ServerStats run_server(const ServerOptions& options);
+
+}  // namespace server
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "image_writer.h"
+#include "qr_spec.h"
+
+// Сообщения длиннее одного символа: Structured Append делит их на части
+// (до 16 символов), каждая часть несёт свой номер, число частей и общую
+// чётность. Части кодируются и рисуются на рабочих потоках независимо.
+struct AppendOptions {
+    qr_spec::EccLevel level = qr_spec::EccLevel::L;
+    int max_version = qr_spec::MAX_VERSION;  // наибольшая версия части
+    int threads = 0;                         // 0 — по числу ядер
+    RenderOptions render;
+};
+
+struct AppendStats {
+    size_t parts = 0;
+    int max_version = 0;  // наибольшая версия среди частей
+    size_t bytes = 0;     // записано байтов изображений
+    double seconds = 0;
+};
+
+// Делит message на наименьшее число частей почти равной длины, каждая из
+// которых с заголовком помещается в max_version; если 16 частей мало,
+// бросает "Message too long"
+std::vector<std::string> split_message(const std::string &message,
+                                       qr_spec::EccLevel level,
+                                       int max_version);
+
+// Пишет части message в файлы filename с номером части перед расширением
+// (out_00.ppm, out_01.ppm, ...)
+AppendStats write_append_files(const std::string &message,
+                               const std::string &filename,
+                               const AppendOptions &options);
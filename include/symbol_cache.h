@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "image_writer.h"
+#include "qr_code.h"
+#include "qr_matrix.h"
+#include "reed_solomon.h"
+
+// Параметры символа; версия определяется сообщением и уровнем
+struct SymbolKey {
+    std::string_view payload;
+    qr_spec::EccLevel level = qr_spec::EccLevel::L;
+    int mask = QRCode::AUTO_MASK;
+    bool with_image = false;  // параметры рендера входят в ключ только с ним
+    RenderOptions render;
+};
+
+// Готовый символ: упакованная матрица и, если запрошено, байты файла
+struct CachedSymbol {
+    int size = 0;
+    int mask = 0;
+    std::vector<QRMatrix::Word> words;  // word_count() слов матрицы
+    std::vector<uint8_t> image;
+
+    void copy_to(QRMatrix& out) const;
+};
+
+// Потокобезопасный LRU-кэш символов, разбитый на шарды по хэшу ключа.
+// У каждого шарда свой мьютекс, список LRU и доля общего бюджета памяти.
+// Записи неизменяемы и отдаются через shared_ptr, поэтому вытеснение не
+// мешает читателям, уже получившим запись.
+class SymbolCache {
+   public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t insertions = 0;
+        uint64_t evictions = 0;
+        size_t entries = 0;
+        size_t bytes = 0;
+    };
+
+    explicit SymbolCache(size_t memory_budget, int shards = 16);
+
+    std::shared_ptr<const CachedSymbol> find(const SymbolKey& key);
+    std::shared_ptr<const CachedSymbol> insert(const SymbolKey& key,
+                                               const QRMatrix& matrix,
+                                               int mask,
+                                               std::vector<uint8_t> image = {});
+
+    // Возвращает запись из кэша или строит символ объектами вызывающего
+    // (matrix — его рабочий буфер) и сохраняет его
+    std::shared_ptr<const CachedSymbol> get_or_create(const SymbolKey& key,
+                                                      ReedSolomon& rs,
+                                                      const QRCode& qr,
+                                                      QRMatrix& matrix);
+
+    Stats stats() const;
+    void clear();
+
+   private:
+    struct Node {
+        uint64_t hash;
+        std::string payload;
+        uint64_t params;  // упакованные level, mask, with_image, render
+        size_t cost;
+        std::shared_ptr<const CachedSymbol> symbol;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::list<Node> lru;  // начало — самые свежие
+        std::unordered_map<uint64_t, std::list<Node>::iterator> index;
+        size_t bytes = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t insertions = 0;
+        uint64_t evictions = 0;
+    };
+
+    static uint64_t pack_params(const SymbolKey& key);
+    static uint64_t hash_key(const SymbolKey& key, uint64_t params);
+    Shard& shard_for(uint64_t hash);
+    void evict(Shard& shard);
+
+    size_t shard_budget_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
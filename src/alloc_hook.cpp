@@ -0,0 +1,58 @@
+// Замена глобальных operator new/delete для подсчёта выделений по этапам
+// (instrument). Линкуется только в исполняемые файлы qr_code и qr_bench
+// сборки с QR_INSTRUMENTATION, в библиотеку qrcode не входит. Выровненные
+// варианты остаются стандартными.
+
+#include <cstdlib>
+#include <new>
+
+#include "instrument.h"
+
+namespace {
+
+// Как стандартный operator new: при нехватке памяти вызывает
+// new_handler и повторяет попытку, без обработчика бросает bad_alloc
+void* allocate(std::size_t size) {
+    for (;;) {
+        void* p = std::malloc(size ? size : 1);
+        if (p) {
+            instrument::detail::record_allocation(size);
+            return p;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+void* allocate_nothrow(std::size_t size) noexcept {
+    try {
+        return allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+}  // namespace
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return allocate_nothrow(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return allocate_nothrow(size);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
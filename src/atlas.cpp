@@ -0,0 +1,295 @@
+#include "atlas.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#include "instrument.h"
+#include "qr_code.h"
+#include "reed_solomon.h"
+
+namespace {
+
+constexpr size_t VERSION_CHUNK = 256;
+constexpr size_t MAX_SIDE = 1 << 20;  // пикселей по каждой стороне листа
+
+template <typename Body>
+void run_workers(int threads, const Body &body) {
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; ++t) workers.emplace_back(body);
+    body();
+    for (auto &worker : workers) worker.join();
+}
+
+// Файл заданного размера, отображённый в память для записи
+class MappedOutput {
+   public:
+    MappedOutput(const std::string &filename, size_t size) : size_(size) {
+        fd_ = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC,
+                     0644);
+        if (fd_ < 0) {
+            throw std::runtime_error("Cannot open " + filename + ": " +
+                                     std::strerror(errno));
+        }
+        // Место выделяется сразу, чтобы нехватка диска была ошибкой
+        // здесь, а не SIGBUS при записи в отображение
+        int error = ::posix_fallocate(fd_, 0, static_cast<off_t>(size));
+        if ((error != 0 && error != EINVAL && error != EOPNOTSUPP) ||
+            ::ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+            ::close(fd_);
+            throw std::runtime_error("Cannot allocate " + filename);
+        }
+        void *data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                            MAP_SHARED, fd_, 0);
+        if (data == MAP_FAILED) {
+            ::close(fd_);
+            throw std::runtime_error("Cannot map " + filename + ": " +
+                                     std::strerror(errno));
+        }
+        data_ = static_cast<uint8_t *>(data);
+    }
+    ~MappedOutput() {
+        ::munmap(data_, size_);
+        ::close(fd_);
+    }
+    MappedOutput(const MappedOutput &) = delete;
+    MappedOutput &operator=(const MappedOutput &) = delete;
+
+    uint8_t *data() { return data_; }
+
+   private:
+    int fd_ = -1;
+    uint8_t *data_ = nullptr;
+    size_t size_;
+};
+
+std::string sheet_filename(const std::string &filename, size_t sheet,
+                           size_t sheets) {
+    return sheets == 1 ? filename : numbered_filename(filename, sheet, 3);
+}
+
+// Геометрия листа; ряд плиток r начинается с пикселя margin + r * pitch
+struct Layout {
+    int max_size = 0;    // сторона наибольшего символа в модулях
+    int tile_modules = 0;
+    int pitch = 0;       // плитка и промежуток после неё
+    size_t row_bytes = 0;
+};
+
+// Рисует ряд плиток row листа вместе с промежутком под ним (у первого
+// ряда — и над ним). Границы модулей всех плиток ряда совпадают, поэтому
+// каждая строка пикселей строится один раз и копируется целиком.
+class BandWriter {
+   public:
+    BandWriter(const std::vector<std::string> &payloads,
+               const std::vector<int> &versions, const Layout &layout,
+               const AtlasOptions &options,
+               const qr_segment::AppendHeader &append,
+               std::atomic<size_t> &failed)
+        : payloads_(payloads),
+          versions_(versions),
+          layout_(layout),
+          options_(options),
+          append_(append),
+          failed_(failed),
+          matrices_(options.columns) {}
+
+    void write(uint8_t *pixels, int row, size_t first_index) {
+        const RenderOptions &render = options_.render;
+        int scale = render.scale;
+        int quiet = render.quiet_zone;
+        size_t row_bytes = layout_.row_bytes;
+        int count = static_cast<int>(std::min<size_t>(
+            options_.columns, payloads_.size() - first_index));
+        for (int c = 0; c < count; ++c) {
+            QRMatrix &matrix = matrices_[c];
+            matrix.reset(0);
+            size_t index = first_index + c;
+            if (versions_[index] == 0) continue;
+            try {
+                qr_segment::AppendHeader header = append_;
+                header.index = static_cast<int>(index);
+                ReedSolomon::Code code =
+                    header.total > 0
+                        ? solomon_.encode(payloads_[index], options_.level,
+                                          header)
+                        : solomon_.encode(payloads_[index], options_.level);
+                qr_.generate(code.data(), code.size(), matrix,
+                             options_.level);
+            } catch (const std::exception &) {
+                // Плитка остаётся пустой, символ считается ошибкой
+                matrix.reset(0);
+                failed_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        instrument::ScopedStage stage(instrument::Stage::RENDER);
+        size_t top = options_.margin + static_cast<size_t>(row) *
+                                           layout_.pitch;
+        size_t begin = row == 0 ? 0 : top;
+        size_t end = top + layout_.pitch;
+        uint8_t background = render.format == ImageFormat::PBM ? 0 : 255;
+        std::memset(pixels + begin * row_bytes, background,
+                    (end - begin) * row_bytes);
+
+        for (int k = 0; k < layout_.tile_modules; ++k) {
+            uint8_t *line = pixels + (top + static_cast<size_t>(k) * scale) *
+                                         row_bytes;
+            bool drawn = false;
+            for (int c = 0; c < count; ++c) {
+                const QRMatrix &matrix = matrices_[c];
+                int offset = quiet + (layout_.max_size - matrix.size()) / 2;
+                int r = k - offset;
+                if (r < 0 || r >= matrix.size()) continue;
+                size_t x = options_.margin +
+                           static_cast<size_t>(c) * layout_.pitch +
+                           static_cast<size_t>(offset) * scale;
+                draw_module_row(matrix, r, scale, render.format, line, x);
+                drawn = true;
+            }
+            if (!drawn) continue;
+            for (int s = 1; s < scale; ++s) {
+                std::memcpy(line + s * row_bytes, line, row_bytes);
+            }
+        }
+    }
+
+   private:
+    const std::vector<std::string> &payloads_;
+    const std::vector<int> &versions_;
+    const Layout &layout_;
+    const AtlasOptions &options_;
+    const qr_segment::AppendHeader &append_;
+    std::atomic<size_t> &failed_;
+    ReedSolomon solomon_;
+    QRCode qr_;
+    std::vector<QRMatrix> matrices_;
+};
+
+}  // namespace
+
+AtlasStats write_atlas(const std::vector<std::string> &payloads,
+                       const std::string &filename,
+                       const AtlasOptions &options) {
+    const RenderOptions &render = options.render;
+    if (options.columns < 1 || options.rows < 0 || options.margin < 0 ||
+        render.scale < 1 || render.quiet_zone < 0) {
+        throw std::runtime_error("Invalid atlas options");
+    }
+    if (render.format == ImageFormat::SVG) {
+        throw std::runtime_error("Atlas sheets are PPM or PBM only");
+    }
+    int threads = options.threads;
+    if (threads <= 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    auto start = std::chrono::steady_clock::now();
+    AtlasStats stats;
+    size_t n = payloads.size();
+    stats.symbols = n;
+    if (n == 0) return stats;
+
+    // Части одного сообщения: общий заголовок, номер ставит BandWriter
+    qr_segment::AppendHeader append;
+    if (options.structured_append) {
+        if (n > qr_segment::MAX_APPEND_SYMBOLS) {
+            throw std::runtime_error("Too many structured append symbols");
+        }
+        append.total = static_cast<int>(n);
+        for (const std::string &payload : payloads) {
+            append.parity ^= qr_segment::append_parity(
+                reinterpret_cast<const uint8_t *>(payload.data()),
+                payload.size());
+        }
+    }
+
+    // Версии всех символов определяют сторону плитки
+    std::vector<int> versions(n, 0);
+    std::atomic<size_t> next{0};
+    run_workers(threads, [&] {
+        for (;;) {
+            size_t first = next.fetch_add(VERSION_CHUNK);
+            if (first >= n) break;
+            size_t last = std::min(n, first + VERSION_CHUNK);
+            for (size_t i = first; i < last; ++i) {
+                try {
+                    versions[i] = ReedSolomon::choose_version(
+                        payloads[i], options.level, nullptr,
+                        options.structured_append);
+                } catch (const std::exception &) {
+                    versions[i] = 0;
+                }
+            }
+        }
+    });
+    int max_version = 1;
+    for (int version : versions) {
+        max_version = std::max(max_version, version);
+        if (version == 0) ++stats.failed;
+    }
+
+    Layout layout;
+    layout.max_size = qr_spec::symbol_size(max_version);
+    layout.tile_modules = layout.max_size + 2 * render.quiet_zone;
+    stats.tile = layout.tile_modules * render.scale;
+    layout.pitch = stats.tile + options.margin;
+    size_t columns = options.columns;
+    size_t total_rows = (n + columns - 1) / columns;
+    size_t sheet_rows = options.rows > 0
+                            ? std::min<size_t>(options.rows, total_rows)
+                            : total_rows;
+    size_t per_sheet = sheet_rows * columns;
+    stats.sheets = (n + per_sheet - 1) / per_sheet;
+
+    size_t width = columns * layout.pitch + options.margin;
+    if (width > MAX_SIDE ||
+        sheet_rows * layout.pitch + options.margin > MAX_SIDE) {
+        throw std::runtime_error("Atlas sheet too large");
+    }
+    layout.row_bytes = image_row_bytes(render.format, static_cast<int>(width));
+
+    // Символы, для которых версия нашлась, но кодирование не удалось
+    std::atomic<size_t> encode_failed{0};
+    for (size_t sheet = 0; sheet < stats.sheets; ++sheet) {
+        size_t first = sheet * per_sheet;
+        size_t count = std::min(per_sheet, n - first);
+        size_t rows = (count + columns - 1) / columns;
+        size_t height = rows * layout.pitch + options.margin;
+        std::string header = image_header(render.format,
+                                          static_cast<int>(width),
+                                          static_cast<int>(height));
+        size_t file_size = header.size() + layout.row_bytes * height;
+
+        MappedOutput output(
+            sheet_filename(filename, sheet, stats.sheets), file_size);
+        std::memcpy(output.data(), header.data(), header.size());
+        uint8_t *pixels = output.data() + header.size();
+
+        std::atomic<size_t> next_row{0};
+        run_workers(threads, [&] {
+            BandWriter writer(payloads, versions, layout, options, append,
+                              encode_failed);
+            for (;;) {
+                size_t row = next_row.fetch_add(1);
+                if (row >= rows) break;
+                writer.write(pixels, static_cast<int>(row),
+                             first + row * columns);
+            }
+        });
+        instrument::record_write(file_size);
+    }
+
+    stats.failed += encode_failed.load();
+    stats.seconds = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+    return stats;
+}
@@ -0,0 +1,181 @@
+#include "batch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.h"
+#include "image_reader.h"
+#include "image_writer.h"
+#include "qr_code.h"
+#include "reed_solomon.h"
+#include "symbol_cache.h"
+
+namespace {
+
+struct Chunk {
+    size_t first_index = 0;
+    std::vector<std::string> payloads;
+};
+
+// Сколько ошибок печатается в stderr; дальше они только считаются
+constexpr size_t MAX_REPORTED_FAILURES = 100;
+
+// Печатает номер записи и причину; строка собирается целиком, чтобы
+// сообщения потоков не перемешивались
+void report_failure(std::atomic<size_t>& reported, size_t index,
+                    const char* reason) {
+    size_t n = reported++;
+    if (n > MAX_REPORTED_FAILURES) return;
+    std::string line =
+        n < MAX_REPORTED_FAILURES
+            ? "Запись " + std::to_string(index) + ": " + reason + "\n"
+            : std::string("Дальнейшие ошибки не печатаются\n");
+    std::cerr << line << std::flush;
+}
+
+std::string record_filename(const std::string& dir, size_t index,
+                            ImageFormat format) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "/%08zu.%s", index,
+                  format == ImageFormat::PBM   ? "pbm"
+                  : format == ImageFormat::SVG ? "svg"
+                                               : "ppm");
+    return dir + name;
+}
+
+}  // namespace
+
+bool read_record(std::istream& in, bool length_delimited,
+                 std::string& payload) {
+    if (!length_delimited) {
+        if (!std::getline(in, payload)) return false;
+        if (!payload.empty() && payload.back() == '\r') payload.pop_back();
+        return true;
+    }
+    unsigned char header[4];
+    if (!in.read(reinterpret_cast<char*>(header), 4)) return false;
+    size_t length = (size_t(header[0]) << 24) | (size_t(header[1]) << 16) |
+                    (size_t(header[2]) << 8) | size_t(header[3]);
+    payload.resize(length);
+    if (!in.read(&payload[0], length)) {
+        throw std::runtime_error("Truncated length-delimited record");
+    }
+    return true;
+}
+
+BatchStats run_batch(const BatchOptions& options) {
+    std::ifstream file;
+    if (options.input != "-") {
+        file.open(options.input, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Cannot open input " + options.input);
+        }
+    }
+    std::istream& in = options.input == "-" ? std::cin : file;
+
+    int threads = options.threads;
+    if (threads <= 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::unique_ptr<SymbolCache> cache;
+    if (options.cache_bytes > 0 && !options.verify) {
+        cache.reset(new SymbolCache(options.cache_bytes));
+    }
+
+    BoundedQueue<Chunk> queue(2 * threads);
+    std::vector<size_t> failed(threads, 0);
+    std::atomic<size_t> reported{0};
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            ReedSolomon solomon;
+            QRCode qr;
+            QRMatrix matrix;
+            std::vector<uint8_t> image;
+            Chunk chunk;
+            while (queue.pop(chunk)) {
+                for (size_t i = 0; i < chunk.payloads.size(); ++i) {
+                    size_t index = chunk.first_index + i;
+                    std::string filename = record_filename(
+                        options.output_dir, index, options.render.format);
+                    try {
+                        if (options.verify) {
+                            read_image_file(filename, matrix);
+                            DecodedSymbol symbol =
+                                decode_symbol(matrix, solomon);
+                            if (symbol.payload != chunk.payloads[i]) {
+                                ++failed[t];
+                                report_failure(reported, index,
+                                               "Payload mismatch");
+                            }
+                        } else if (cache) {
+                            SymbolKey key;
+                            key.payload = chunk.payloads[i];
+                            key.level = options.level;
+                            key.with_image = true;
+                            key.render = options.render;
+                            auto symbol = cache->get_or_create(
+                                key, solomon, qr, matrix);
+                            write_image_file(filename, symbol->image.data(),
+                                             symbol->image.size());
+                        } else {
+                            ReedSolomon::Code msg = solomon.encode(
+                                chunk.payloads[i], options.level);
+                            qr.generate(msg.data(), msg.size(), matrix,
+                                        options.level);
+                            save_image(matrix, filename, options.render,
+                                       image);
+                        }
+                    } catch (const std::exception& e) {
+                        ++failed[t];
+                        report_failure(reported, index, e.what());
+                    }
+                }
+            }
+        });
+    }
+
+    BatchStats stats;
+    try {
+        Chunk chunk;
+        std::string payload;
+        while (read_record(in, options.length_delimited, payload)) {
+            if (chunk.payloads.empty()) chunk.first_index = stats.records;
+            chunk.payloads.push_back(std::move(payload));
+            ++stats.records;
+            if (chunk.payloads.size() == options.chunk_size) {
+                queue.push(std::move(chunk));
+                chunk = Chunk();
+            }
+        }
+        if (!chunk.payloads.empty()) queue.push(std::move(chunk));
+    } catch (...) {
+        queue.close();
+        for (auto& worker : workers) worker.join();
+        throw;
+    }
+    queue.close();
+    for (auto& worker : workers) worker.join();
+
+    for (size_t f : failed) stats.failed += f;
+    if (cache) {
+        SymbolCache::Stats cache_stats = cache->stats();
+        stats.cache_hits = cache_stats.hits;
+        stats.cache_misses = cache_stats.misses;
+    }
+    stats.seconds = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+    return stats;
+}
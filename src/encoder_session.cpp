@@ -0,0 +1,100 @@
+#include "encoder_session.h"
+
+#include <stdexcept>
+
+#include "instrument.h"
+
+void EncoderSession::set_message(const std::string &message,
+                                 EccLevel level) {
+    if (ready_ && message == message_ && level == level_) return;
+    ready_ = false;
+    std::vector<qr_segment::Segment> segments;
+    {
+        instrument::ScopedStage stage(instrument::Stage::SEGMENT);
+        version_ = ReedSolomon::choose_version(message, level, &segments);
+        data_.resize(qr_spec::data_codewords(version_, level));
+        ReedSolomon::get_code(message, segments, version_, level,
+                              data_.data());
+    }
+    {
+        instrument::ScopedStage stage(instrument::Stage::RS_ENCODE);
+        codewords_.resize(qr_spec::total_codewords(version_));
+        solomon_.encode_message(data_.data(), version_, level,
+                                codewords_.data());
+    }
+    {
+        instrument::ScopedStage stage(instrument::Stage::PLACEMENT);
+        const QRCode::Template &tmpl = QRCode::get_template(version_);
+        unmasked_.copy_from(tmpl.patterns);
+        QRCode::fill_matrix_by_message(tmpl, codewords_.data(),
+                                       codewords_.size(), unmasked_);
+    }
+    ++stats_.encodes;
+
+    message_ = message;
+    level_ = level;
+    for (bool &ready : masked_ready_) ready = false;
+    best_mask_ = QRCode::AUTO_MASK;
+    image_mask_ = QRCode::AUTO_MASK;
+    ready_ = true;
+}
+
+int EncoderSession::resolve_mask(int mask) {
+    if (!ready_) throw std::runtime_error("No message set");
+    if (mask == QRCode::AUTO_MASK) return best_mask();
+    if (mask < 0 || mask >= QRCode::MASK_COUNT) {
+        throw std::runtime_error("Invalid mask index");
+    }
+    return mask;
+}
+
+const QRMatrix &EncoderSession::symbol(int mask) {
+    mask = resolve_mask(mask);
+    QRMatrix &out = masked_[mask];
+    if (!masked_ready_[mask]) {
+        instrument::ScopedStage stage(instrument::Stage::MASK);
+        const QRCode::Template &tmpl = QRCode::get_template(version_);
+        out.copy_from(unmasked_);
+        QRCode::apply_data_mask(tmpl, mask, out);
+        QRCode::apply_mask(level_, mask, out);
+        masked_ready_[mask] = true;
+        ++stats_.masks;
+    }
+    return out;
+}
+
+// Тот же перебор, что QRCode::select_mask, но кандидаты остаются в кэше
+int EncoderSession::best_mask() {
+    if (!ready_) throw std::runtime_error("No message set");
+    if (best_mask_ != QRCode::AUTO_MASK) return best_mask_;
+    int best_score = 0;
+    for (int mask = 0; mask < QRCode::MASK_COUNT; ++mask) {
+        const QRMatrix &candidate = symbol(mask);
+        instrument::ScopedStage stage(instrument::Stage::MASK);
+        int score = QRCode::penalty(candidate);
+        ++stats_.penalties;
+        if (mask == 0 || score < best_score) {
+            best_mask_ = mask;
+            best_score = score;
+        }
+    }
+    return best_mask_;
+}
+
+const std::vector<uint8_t> &EncoderSession::render(
+    const RenderOptions &options, int mask) {
+    mask = resolve_mask(mask);
+    if (image_mask_ == mask && image_options_.scale == options.scale &&
+        image_options_.quiet_zone == options.quiet_zone &&
+        image_options_.format == options.format) {
+        return image_;
+    }
+    // Неудачный рендер не должен оставить старое изображение под новым
+    // ключом
+    image_mask_ = QRCode::AUTO_MASK;
+    render_image(symbol(mask), options, image_);
+    image_options_ = options;
+    image_mask_ = mask;
+    ++stats_.renders;
+    return image_;
+}
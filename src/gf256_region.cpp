@@ -0,0 +1,308 @@
+#include "gf256_region.h"
+
+#include <atomic>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+#define QR_GF256_X86 1
+#include <immintrin.h>
+#endif
+
+namespace gf256 {
+
+namespace {
+
+constexpr int MAX_DEGREE = MAX_GENERATOR_DEGREE;
+
+// Строки умножения генераторов для скалярного ядра, хранятся подряд:
+// mul[offset(n) + f * n + j] = g_n[j + 1] * f
+constexpr int generator_offset(int nsym) {
+    return 256 * nsym * (nsym - 1) / 2;
+}
+
+struct GeneratorTables {
+    std::array<uint8_t, generator_offset(MAX_DEGREE + 1)> mul{};
+    // Коэффициенты g_n[1..n], дополненные нулями до 32 байтов
+    alignas(32) std::array<std::array<uint8_t, 32>, MAX_DEGREE + 1> poly{};
+    // Степени корней для синдромов: powers[t][j] = a^(-j (t + 1))
+    alignas(32) std::array<std::array<uint8_t, 32>, MAX_DEGREE> powers{};
+};
+
+constexpr GeneratorTables make_generator_tables() {
+    GeneratorTables t;
+    for (int n = 1; n <= MAX_DEGREE; ++n) {
+        const auto& coef = GENERATOR_POLYS.coef[n];
+        for (int j = 0; j < n; ++j) t.poly[n][j] = coef[j];
+        for (int f = 0; f < 256; ++f) {
+            for (int j = 0; j < n; ++j) {
+                t.mul[generator_offset(n) + f * n + j] =
+                    static_cast<uint8_t>(mul(coef[j], f));
+            }
+        }
+    }
+    for (int k = 0; k < MAX_DEGREE; ++k) {
+        for (int j = 0; j < 32; ++j) {
+            int power = (255 - j * (k + 1) % 255) % 255;
+            t.powers[k][j] = static_cast<uint8_t>(exp(power));
+        }
+    }
+    return t;
+}
+
+constexpr GeneratorTables GENERATORS = make_generator_tables();
+
+void scalar_mul(uint8_t* dst, const uint8_t* src, int c, size_t n) {
+    const uint8_t* lo = SPLIT_TABLES.lo[c].data();
+    const uint8_t* hi = SPLIT_TABLES.hi[c].data();
+    for (size_t i = 0; i < n; ++i) dst[i] = lo[src[i] & 15] ^ hi[src[i] >> 4];
+}
+
+void scalar_mul_add(uint8_t* dst, const uint8_t* src, int c, size_t n) {
+    const uint8_t* lo = SPLIT_TABLES.lo[c].data();
+    const uint8_t* hi = SPLIT_TABLES.hi[c].data();
+    for (size_t i = 0; i < n; ++i) dst[i] ^= lo[src[i] & 15] ^ hi[src[i] >> 4];
+}
+
+// Сдвиговый регистр по готовым строкам f * g
+void scalar_remainder(const uint8_t* data, size_t n, int nsym,
+                      uint8_t* rem) {
+    const uint8_t* mul = GENERATORS.mul.data() + generator_offset(nsym);
+    std::memset(rem, 0, nsym);
+    for (size_t i = 0; i < n; ++i) {
+        const uint8_t* row = mul + (data[i] ^ rem[0]) * nsym;
+        for (int j = 0; j + 1 < nsym; ++j) rem[j] = rem[j + 1] ^ row[j];
+        rem[nsym - 1] = row[nsym - 1];
+    }
+}
+
+constexpr RegionKernels SCALAR_KERNELS = {"scalar", scalar_mul,
+                                          scalar_mul_add, scalar_remainder};
+
+#ifdef QR_GF256_X86
+
+#define QR_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define QR_TARGET_AVX2 __attribute__((target("avx2")))
+
+QR_TARGET_SSSE3 inline __m128i mul_128(__m128i x, __m128i lo, __m128i hi) {
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    __m128i l = _mm_shuffle_epi8(lo, _mm_and_si128(x, mask));
+    __m128i h = _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi16(x, 4), mask));
+    return _mm_xor_si128(l, h);
+}
+
+QR_TARGET_SSSE3 inline __m128i load_lo_128(int c) {
+    return _mm_load_si128(
+        reinterpret_cast<const __m128i*>(SPLIT_TABLES.lo[c].data()));
+}
+
+QR_TARGET_SSSE3 inline __m128i load_hi_128(int c) {
+    return _mm_load_si128(
+        reinterpret_cast<const __m128i*>(SPLIT_TABLES.hi[c].data()));
+}
+
+QR_TARGET_SSSE3 void ssse3_mul(uint8_t* dst, const uint8_t* src, int c,
+                               size_t n) {
+    __m128i lo = load_lo_128(c);
+    __m128i hi = load_hi_128(c);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                         mul_128(x, lo, hi));
+    }
+    scalar_mul(dst + i, src + i, c, n - i);
+}
+
+QR_TARGET_SSSE3 void ssse3_mul_add(uint8_t* dst, const uint8_t* src, int c,
+                                   size_t n) {
+    __m128i lo = load_lo_128(c);
+    __m128i hi = load_hi_128(c);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                         _mm_xor_si128(d, mul_128(x, lo, hi)));
+    }
+    scalar_mul_add(dst + i, src + i, c, n - i);
+}
+
+// Регистр остатка — два вектора по 16 байтов; шаг — сдвиг на байт и
+// прибавление f * g, где коэффициенты g стоят в байтах векторов
+QR_TARGET_SSSE3 void ssse3_remainder(const uint8_t* data, size_t n, int nsym,
+                                     uint8_t* rem) {
+    const uint8_t* poly = GENERATORS.poly[nsym].data();
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    __m128i g0 = _mm_load_si128(reinterpret_cast<const __m128i*>(poly));
+    __m128i g1 = _mm_load_si128(reinterpret_cast<const __m128i*>(poly + 16));
+    __m128i g0l = _mm_and_si128(g0, mask);
+    __m128i g0h = _mm_and_si128(_mm_srli_epi16(g0, 4), mask);
+    __m128i g1l = _mm_and_si128(g1, mask);
+    __m128i g1h = _mm_and_si128(_mm_srli_epi16(g1, 4), mask);
+    __m128i r0 = _mm_setzero_si128();
+    __m128i r1 = _mm_setzero_si128();
+    for (size_t i = 0; i < n; ++i) {
+        int f = (data[i] ^ _mm_cvtsi128_si32(r0)) & 0xff;
+        r0 = _mm_alignr_epi8(r1, r0, 1);
+        r1 = _mm_srli_si128(r1, 1);
+        __m128i lo = load_lo_128(f);
+        __m128i hi = load_hi_128(f);
+        r0 = _mm_xor_si128(r0, _mm_xor_si128(_mm_shuffle_epi8(lo, g0l),
+                                             _mm_shuffle_epi8(hi, g0h)));
+        r1 = _mm_xor_si128(r1, _mm_xor_si128(_mm_shuffle_epi8(lo, g1l),
+                                             _mm_shuffle_epi8(hi, g1h)));
+    }
+    alignas(16) uint8_t out[32];
+    _mm_store_si128(reinterpret_cast<__m128i*>(out), r0);
+    _mm_store_si128(reinterpret_cast<__m128i*>(out + 16), r1);
+    std::memcpy(rem, out, nsym);
+}
+
+QR_TARGET_AVX2 inline __m256i mul_256(__m256i x, __m256i lo, __m256i hi) {
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+    __m256i l = _mm256_shuffle_epi8(lo, _mm256_and_si256(x, mask));
+    __m256i h = _mm256_shuffle_epi8(
+        hi, _mm256_and_si256(_mm256_srli_epi16(x, 4), mask));
+    return _mm256_xor_si256(l, h);
+}
+
+QR_TARGET_AVX2 inline __m256i load_lo_256(int c) {
+    return _mm256_broadcastsi128_si256(_mm_load_si128(
+        reinterpret_cast<const __m128i*>(SPLIT_TABLES.lo[c].data())));
+}
+
+QR_TARGET_AVX2 inline __m256i load_hi_256(int c) {
+    return _mm256_broadcastsi128_si256(_mm_load_si128(
+        reinterpret_cast<const __m128i*>(SPLIT_TABLES.hi[c].data())));
+}
+
+QR_TARGET_AVX2 void avx2_mul(uint8_t* dst, const uint8_t* src, int c,
+                             size_t n) {
+    __m256i lo = load_lo_256(c);
+    __m256i hi = load_hi_256(c);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+                            mul_256(x, lo, hi));
+    }
+    scalar_mul(dst + i, src + i, c, n - i);
+}
+
+QR_TARGET_AVX2 void avx2_mul_add(uint8_t* dst, const uint8_t* src, int c,
+                                 size_t n) {
+    __m256i lo = load_lo_256(c);
+    __m256i hi = load_hi_256(c);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i d =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+                            _mm256_xor_si256(d, mul_256(x, lo, hi)));
+    }
+    scalar_mul_add(dst + i, src + i, c, n - i);
+}
+
+// Весь регистр остатка (до 32 байтов) в одном векторе; сдвиг на байт
+// через обе 128-битные половины
+QR_TARGET_AVX2 void avx2_remainder(const uint8_t* data, size_t n, int nsym,
+                                   uint8_t* rem) {
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+    __m256i g = _mm256_load_si256(
+        reinterpret_cast<const __m256i*>(GENERATORS.poly[nsym].data()));
+    __m256i gl = _mm256_and_si256(g, mask);
+    __m256i gh = _mm256_and_si256(_mm256_srli_epi16(g, 4), mask);
+    __m256i r = _mm256_setzero_si256();
+    for (size_t i = 0; i < n; ++i) {
+        int f = (data[i] ^ _mm_cvtsi128_si32(_mm256_castsi256_si128(r))) &
+                0xff;
+        r = _mm256_alignr_epi8(_mm256_permute2x128_si256(r, r, 0x81), r, 1);
+        __m256i lo = load_lo_256(f);
+        __m256i hi = load_hi_256(f);
+        r = _mm256_xor_si256(r, _mm256_xor_si256(_mm256_shuffle_epi8(lo, gl),
+                                                 _mm256_shuffle_epi8(hi, gh)));
+    }
+    alignas(32) uint8_t out[32];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(out), r);
+    std::memcpy(rem, out, nsym);
+}
+
+constexpr RegionKernels SSSE3_KERNELS = {"ssse3", ssse3_mul, ssse3_mul_add,
+                                         ssse3_remainder};
+constexpr RegionKernels AVX2_KERNELS = {"avx2", avx2_mul, avx2_mul_add,
+                                        avx2_remainder};
+
+#endif  // QR_GF256_X86
+
+bool supported(const RegionKernels& kernels) {
+#ifdef QR_GF256_X86
+    if (&kernels == &AVX2_KERNELS) return __builtin_cpu_supports("avx2");
+    if (&kernels == &SSSE3_KERNELS) return __builtin_cpu_supports("ssse3");
+#endif
+    return &kernels == &SCALAR_KERNELS;
+}
+
+// Ядра от лучшего к худшему
+const RegionKernels* const ALL_KERNELS[] = {
+#ifdef QR_GF256_X86
+    &AVX2_KERNELS,
+    &SSSE3_KERNELS,
+#endif
+    &SCALAR_KERNELS,
+};
+
+const RegionKernels* detect() {
+    for (const RegionKernels* kernels : ALL_KERNELS) {
+        if (supported(*kernels)) return kernels;
+    }
+    return &SCALAR_KERNELS;
+}
+
+std::atomic<const RegionKernels*> current_kernels{nullptr};
+
+}  // namespace
+
+const RegionKernels& region_kernels() {
+    const RegionKernels* kernels =
+        current_kernels.load(std::memory_order_acquire);
+    if (kernels) return *kernels;
+    const RegionKernels* expected = nullptr;
+    current_kernels.compare_exchange_strong(expected, detect(),
+                                            std::memory_order_acq_rel);
+    return *current_kernels.load(std::memory_order_acquire);
+}
+
+bool select_region_kernels(const char* name) {
+    for (const RegionKernels* kernels : ALL_KERNELS) {
+        if (std::strcmp(kernels->name, name) == 0 && supported(*kernels)) {
+            current_kernels.store(kernels, std::memory_order_release);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool syndromes(const uint8_t* msg, size_t n, int nsym, uint8_t* synd) {
+    // msg(x) x^nsym = q(x) g(x) + r(x) и g(a^j) = 0, поэтому
+    // msg(a^j) = r(a^j) a^(-j nsym) = sum_t r[t] a^(-j (t + 1))
+    // Сумма набирается в 32-байтовом буфере, чтобы ядро умножало целыми
+    // векторами
+    const RegionKernels& kernels = region_kernels();
+    uint8_t rem[MAX_DEGREE];
+    kernels.remainder(msg, n, nsym, rem);
+    alignas(32) uint8_t acc[32] = {};
+    bool any = false;
+    for (int t = 0; t < nsym; ++t) {
+        if (rem[t] == 0) continue;
+        kernels.mul_add(acc, GENERATORS.powers[t].data(), rem[t], 32);
+        any = true;
+    }
+    std::memcpy(synd, acc, nsym);
+    return any;
+}
+
+}  // namespace gf256
@@ -0,0 +1,241 @@
+#include "image_reader.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include "instrument.h"
+#include "qr_code.h"
+
+namespace {
+
+// Растр после заголовка: pixel_bytes байтов на пиксель, 0 — PBM по битам
+struct Raster {
+    int width = 0;
+    int height = 0;
+    int pixel_bytes = 0;
+    int threshold = 0;  // тёмный — сумма каналов ниже порога
+    size_t row_bytes = 0;
+    const uint8_t *pixels = nullptr;
+
+    bool dark(int x, int y) const {
+        const uint8_t *row = pixels + y * row_bytes;
+        if (pixel_bytes == 0) return (row[x / 8] >> (7 - x % 8)) & 1;
+        const uint8_t *p = row + x * pixel_bytes;
+        int sum = p[0];
+        if (pixel_bytes == 3) sum += p[1] + p[2];
+        return sum < threshold;
+    }
+};
+
+class HeaderParser {
+   public:
+    HeaderParser(const uint8_t *data, size_t size)
+        : data_(data), size_(size) {}
+
+    int next_int() {
+        skip_space();
+        int value = 0;
+        size_t start = pos_;
+        while (pos_ < size_ && data_[pos_] >= '0' && data_[pos_] <= '9') {
+            value = value * 10 + (data_[pos_++] - '0');
+            if (value > 1 << 20) break;
+        }
+        if (pos_ == start || value > 1 << 20) {
+            throw std::runtime_error("Malformed image header");
+        }
+        return value;
+    }
+
+    // Растр начинается после одного пробельного символа
+    size_t raster_offset() {
+        if (pos_ >= size_) throw std::runtime_error("Truncated image");
+        return pos_ + 1;
+    }
+
+   private:
+    void skip_space() {
+        while (pos_ < size_) {
+            uint8_t c = data_[pos_];
+            if (c == '#') {
+                while (pos_ < size_ && data_[pos_] != '\n') ++pos_;
+            } else if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+                ++pos_;
+            } else {
+                break;
+            }
+        }
+    }
+
+    const uint8_t *data_;
+    size_t size_;
+    size_t pos_ = 2;  // после магического числа
+};
+
+Raster parse_header(const uint8_t *data, size_t size) {
+    if (size < 2 || data[0] != 'P' ||
+        (data[1] != '4' && data[1] != '5' && data[1] != '6')) {
+        throw std::runtime_error("Unsupported image format");
+    }
+    Raster raster;
+    HeaderParser parser(data, size);
+    raster.width = parser.next_int();
+    raster.height = parser.next_int();
+    if (data[1] == '4') {
+        raster.row_bytes = (raster.width + 7) / 8;
+    } else {
+        int maxval = parser.next_int();
+        if (maxval < 1 || maxval > 255) {
+            throw std::runtime_error("Unsupported image depth");
+        }
+        raster.pixel_bytes = data[1] == '6' ? 3 : 1;
+        raster.threshold = (raster.pixel_bytes * maxval + 1) / 2;
+        raster.row_bytes = static_cast<size_t>(raster.width) *
+                           raster.pixel_bytes;
+    }
+    size_t offset = parser.raster_offset();
+    if (raster.width == 0 || raster.height == 0 ||
+        (size - offset) / raster.row_bytes <
+            static_cast<size_t>(raster.height)) {
+        throw std::runtime_error("Truncated image");
+    }
+    raster.pixels = data + offset;
+    return raster;
+}
+
+// Поисковый узор 7x7: тёмные рамка и центр 3x3, светлое кольцо между ними
+bool finder_module(int row, int column) {
+    int dr = row > 3 ? row - 3 : 3 - row;
+    int dc = column > 3 ? column - 3 : 3 - column;
+    return (dr > dc ? dr : dc) != 2;
+}
+
+class MappedFile {
+   public:
+    explicit MappedFile(const std::string &filename) {
+        int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open " + filename + ": " +
+                                     std::strerror(errno));
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            throw std::runtime_error("Cannot map " + filename);
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        void *data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            throw std::runtime_error("Cannot map " + filename + ": " +
+                                     std::strerror(errno));
+        }
+        data_ = static_cast<const uint8_t *>(data);
+    }
+    ~MappedFile() { ::munmap(const_cast<uint8_t *>(data_), size_); }
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const uint8_t *data() const { return data_; }
+    size_t size() const { return size_; }
+
+   private:
+    const uint8_t *data_ = nullptr;
+    size_t size_ = 0;
+};
+
+}  // namespace
+
+void read_image(const uint8_t *data, size_t size, QRMatrix &out) {
+    instrument::ScopedStage stage(instrument::Stage::READ);
+    Raster raster = parse_header(data, size);
+
+    // Первый тёмный пиксель — угол левого верхнего узора; в PBM светлые
+    // строки пропускаются целыми байтами
+    int x0 = -1;
+    int y0 = 0;
+    for (; y0 < raster.height && x0 < 0; ++y0) {
+        const uint8_t *row = raster.pixels + y0 * raster.row_bytes;
+        for (int x = 0; x < raster.width; ++x) {
+            if (raster.pixel_bytes == 0 && x % 8 == 0 && row[x / 8] == 0) {
+                x += 7;
+                continue;
+            }
+            if (raster.dark(x, y0)) {
+                x0 = x;
+                break;
+            }
+        }
+    }
+    if (x0 < 0) throw std::runtime_error("Finder patterns not found");
+    --y0;
+
+    // Верхняя кромка узора — 7 модулей; правая и нижняя границы символа —
+    // последние тёмные пиксели строки y0 и столбца x0
+    int run = 0;
+    while (x0 + run < raster.width && raster.dark(x0 + run, y0)) ++run;
+    int x1 = raster.width - 1;
+    while (x1 > x0 && !raster.dark(x1, y0)) --x1;
+    int y1 = raster.height - 1;
+    while (y1 > y0 && !raster.dark(x0, y1)) --y1;
+    int width = x1 - x0 + 1;
+    int height = y1 - y0 + 1;
+    int modules = run > 0 ? (7 * width + run / 2) / run : 0;
+    int version = (modules - 17) / 4;
+    if (run < 7 || width != height || version < 1 ||
+        version > qr_spec::MAX_VERSION ||
+        qr_spec::symbol_size(version) != modules) {
+        throw std::runtime_error("Finder patterns not found");
+    }
+
+    // Центр клетки (row, column) в целочисленной арифметике
+    out.reset(modules);
+    for (int row = 0; row < modules; ++row) {
+        int y = y0 + static_cast<int>((2 * row + 1) * int64_t(height) /
+                                      (2 * modules));
+        QRMatrix::Word *line = out.row(row);
+        for (int column = 0; column < modules; ++column) {
+            int x = x0 + static_cast<int>((2 * column + 1) * int64_t(width) /
+                                          (2 * modules));
+            line[column / QRMatrix::WORD_BITS] |=
+                QRMatrix::Word(raster.dark(x, y))
+                << (column % QRMatrix::WORD_BITS);
+        }
+    }
+
+    // Все три узора должны совпасть с образцом почти полностью
+    int mismatches = 0;
+    for (int r = 0; r < 7; ++r) {
+        for (int c = 0; c < 7; ++c) {
+            bool expected = finder_module(r, c);
+            mismatches += out.get(r, c) != expected;
+            mismatches += out.get(r, modules - 7 + c) != expected;
+            mismatches += out.get(modules - 7 + r, c) != expected;
+        }
+    }
+    if (mismatches > 3 * 49 / 10) {
+        throw std::runtime_error("Finder patterns not found");
+    }
+}
+
+void read_image_file(const std::string &filename, QRMatrix &out) {
+    MappedFile file(filename);
+    read_image(file.data(), file.size(), out);
+}
+
+DecodedSymbol decode_symbol(const QRMatrix &symbol, ReedSolomon &solomon) {
+    uint8_t codewords[qr_spec::MAX_TOTAL_CODEWORDS];
+    DecodedSymbol result;
+    size_t n = QRCode::read_codewords(symbol, codewords, result.level,
+                                      result.mask);
+    result.version = (symbol.size() - 17) / 4;
+    result.payload = solomon.decode(ReedSolomon::Code(codewords, codewords + n),
+                                    result.level, {}, &result.correction,
+                                    &result.append);
+    return result;
+}
@@ -0,0 +1,253 @@
+#include "image_writer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "instrument.h"
+
+namespace {
+
+size_t write_header(ImageFormat format, int width,
+                    std::vector<uint8_t> &buffer) {
+    std::string header = image_header(format, width, width);
+    buffer.assign(header.begin(), header.end());
+    return header.size();
+}
+
+// Закрашивает биты [x, x + count) строки P4 по байтам
+void fill_bits(uint8_t *line, size_t x, size_t count) {
+    size_t end = x + count;
+    for (size_t p = x; p < end;) {
+        size_t byte = p / 8;
+        int first = static_cast<int>(p % 8);
+        int n = static_cast<int>(std::min<size_t>(8 - first, end - p));
+        line[byte] |= static_cast<uint8_t>(((0xFF00 >> n) & 0xFF) >> first);
+        p += n;
+    }
+}
+
+void render_ppm(const QRMatrix &matrix, int scale, int quiet,
+                std::vector<uint8_t> &buffer) {
+    int size = matrix.size();
+    int width = (size + 2 * quiet) * scale;
+    size_t row_bytes = static_cast<size_t>(width) * 3;
+    size_t offset = write_header(ImageFormat::PPM, width, buffer);
+    buffer.resize(offset + row_bytes * width);
+    uint8_t *out = buffer.data() + offset;
+
+    // Рамка сверху и снизу — сплошной белый цвет
+    size_t quiet_bytes = row_bytes * quiet * scale;
+    std::memset(out, 255, quiet_bytes);
+    std::memset(out + row_bytes * (width - quiet * scale), 255, quiet_bytes);
+    out += quiet_bytes;
+
+    for (int i = 0; i < size; ++i) {
+        uint8_t *line = out;
+        std::memset(line, 255, row_bytes);
+        draw_module_row(matrix, i, scale, ImageFormat::PPM, line,
+                        static_cast<size_t>(quiet) * scale);
+        out += row_bytes;
+        for (int si = 1; si < scale; ++si, out += row_bytes) {
+            std::memcpy(out, line, row_bytes);
+        }
+    }
+}
+
+// Строка P4: биты от старшего к младшему, 1 — чёрный пиксель
+void render_pbm(const QRMatrix &matrix, int scale, int quiet,
+                std::vector<uint8_t> &buffer) {
+    int size = matrix.size();
+    int width = (size + 2 * quiet) * scale;
+    size_t row_bytes = (static_cast<size_t>(width) + 7) / 8;
+    size_t offset = write_header(ImageFormat::PBM, width, buffer);
+    buffer.resize(offset + row_bytes * width);
+    uint8_t *out = buffer.data() + offset;
+
+    size_t quiet_bytes = row_bytes * quiet * scale;
+    std::memset(out, 0, quiet_bytes);
+    std::memset(out + row_bytes * (width - quiet * scale), 0, quiet_bytes);
+    out += quiet_bytes;
+
+    for (int i = 0; i < size; ++i) {
+        uint8_t *line = out;
+        std::memset(line, 0, row_bytes);
+        draw_module_row(matrix, i, scale, ImageFormat::PBM, line,
+                        static_cast<size_t>(quiet) * scale);
+        out += row_bytes;
+        for (int si = 1; si < scale; ++si, out += row_bytes) {
+            std::memcpy(out, line, row_bytes);
+        }
+    }
+}
+
+// Текст SVG дописывается в буфер без промежуточных строк
+class SvgWriter {
+   public:
+    explicit SvgWriter(std::vector<uint8_t> &buffer) : buffer_(buffer) {}
+
+    SvgWriter &operator<<(const char *text) {
+        buffer_.insert(buffer_.end(), text, text + std::strlen(text));
+        return *this;
+    }
+
+    SvgWriter &operator<<(char c) {
+        buffer_.push_back(static_cast<uint8_t>(c));
+        return *this;
+    }
+
+    SvgWriter &operator<<(int value) {
+        char digits[12];
+        int n = 0;
+        unsigned magnitude = value < 0 ? 0u - static_cast<unsigned>(value)
+                                       : static_cast<unsigned>(value);
+        do {
+            digits[n++] = static_cast<char>('0' + magnitude % 10);
+            magnitude /= 10;
+        } while (magnitude);
+        if (value < 0) buffer_.push_back('-');
+        while (n > 0) buffer_.push_back(digits[--n]);
+        return *this;
+    }
+
+   private:
+    std::vector<uint8_t> &buffer_;
+};
+
+// Серия — подпуть "h длина v1 h-длина z"; после z текущая точка
+// возвращается в начало серии, и следующая задаётся смещением от неё
+void render_svg(const QRMatrix &matrix, int scale, int quiet,
+                std::vector<uint8_t> &buffer) {
+    int size = matrix.size();
+    int width = size + 2 * quiet;
+    buffer.clear();
+    SvgWriter out(buffer);
+    out << "<svg xmlns=\"http://www.w3.org/2000/svg\" viewBox=\"0 0 "
+        << width << ' ' << width << "\" width=\"" << width * scale
+        << "\" height=\"" << width * scale
+        << "\" shape-rendering=\"crispEdges\">\n"
+        << "<path fill=\"#fff\" d=\"M0 0h" << width << 'v' << width
+        << "H0z\"/>\n<path d=\"";
+
+    int x = 0;
+    int y = 0;
+    bool first = true;
+    for (int r = 0; r < size; ++r) {
+        for (int start = matrix.find_next(r, 0, true); start < size;
+             start = matrix.find_next(r, start, true)) {
+            int stop = matrix.find_next(r, start, false);
+            int run = stop - start;
+            if (first) {
+                out << 'M' << start + quiet << ' ' << r + quiet;
+                first = false;
+            } else {
+                out << 'm' << start + quiet - x << ' ' << r + quiet - y;
+            }
+            out << 'h' << run << "v1h-" << run << 'z';
+            x = start + quiet;
+            y = r + quiet;
+            start = stop;
+        }
+    }
+    out << "\"/>\n</svg>\n";
+}
+
+}  // namespace
+
+std::string image_header(ImageFormat format, int width, int height) {
+    char header[64];
+    int length = std::snprintf(header, sizeof(header), "%s\n%d %d\n%s",
+                               format == ImageFormat::PBM ? "P4" : "P6",
+                               width, height,
+                               format == ImageFormat::PBM ? "" : "255\n");
+    return std::string(header, length);
+}
+
+size_t image_row_bytes(ImageFormat format, int width) {
+    return format == ImageFormat::PBM ? (static_cast<size_t>(width) + 7) / 8
+                                      : static_cast<size_t>(width) * 3;
+}
+
+// Серии тёмных модулей ищутся по словам и закрашиваются одним отрезком
+void draw_module_row(const QRMatrix &matrix, int row, int scale,
+                     ImageFormat format, uint8_t *line, size_t x) {
+    int size = matrix.size();
+    for (int start = matrix.find_next(row, 0, true); start < size;
+         start = matrix.find_next(row, start, true)) {
+        int stop = matrix.find_next(row, start, false);
+        size_t first = x + static_cast<size_t>(start) * scale;
+        size_t count = static_cast<size_t>(stop - start) * scale;
+        start = stop;
+        if (format == ImageFormat::PBM) {
+            fill_bits(line, first, count);
+        } else {
+            std::memset(line + first * 3, 0, count * 3);
+        }
+    }
+}
+
+void render_image(const QRMatrix &matrix, const RenderOptions &options,
+                  std::vector<uint8_t> &buffer) {
+    instrument::ScopedStage stage(instrument::Stage::RENDER);
+    if (options.scale < 1 || options.quiet_zone < 0) {
+        throw std::runtime_error("Invalid render options");
+    }
+    if (options.format == ImageFormat::SVG) {
+        render_svg(matrix, options.scale, options.quiet_zone, buffer);
+    } else if (options.format == ImageFormat::PBM) {
+        render_pbm(matrix, options.scale, options.quiet_zone, buffer);
+    } else {
+        render_ppm(matrix, options.scale, options.quiet_zone, buffer);
+    }
+}
+
+void write_image_file(const std::string &filename, const uint8_t *data,
+                      size_t size) {
+    instrument::ScopedStage stage(instrument::Stage::WRITE);
+    std::ofstream ofs(filename, std::ios::binary);
+    ofs.write(reinterpret_cast<const char *>(data), size);
+    if (!ofs) {
+        throw std::runtime_error("Cannot write " + filename);
+    }
+    instrument::record_write(size);
+}
+
+std::string numbered_filename(const std::string &filename, size_t index,
+                              int digits) {
+    // Без буфера фиксированной длины: номер любой величины не обрезается
+    std::string number = std::to_string(index);
+    std::string suffix = "_";
+    if (digits > static_cast<int>(number.size())) {
+        suffix.append(digits - number.size(), '0');
+    }
+    suffix += number;
+    size_t dot = filename.rfind('.');
+    size_t slash = filename.rfind('/');
+    if (dot == std::string::npos ||
+        (slash != std::string::npos && dot < slash)) {
+        return filename + suffix;
+    }
+    return filename.substr(0, dot) + suffix + filename.substr(dot);
+}
+
+void save_image(const QRMatrix &matrix, const std::string &filename,
+                const RenderOptions &options, std::vector<uint8_t> &buffer) {
+    render_image(matrix, options, buffer);
+    write_image_file(filename, buffer.data(), buffer.size());
+}
+
+void save_qr_to_ppm(const QRMatrix &matrix, const std::string &filename,
+                    int scale, int quiet_zone) {
+    std::vector<uint8_t> buffer;
+    save_image(matrix, filename, {scale, quiet_zone, ImageFormat::PPM},
+               buffer);
+}
+
+void save_qr_to_pbm(const QRMatrix &matrix, const std::string &filename,
+                    int scale, int quiet_zone) {
+    std::vector<uint8_t> buffer;
+    save_image(matrix, filename, {scale, quiet_zone, ImageFormat::PBM},
+               buffer);
+}
@@ -0,0 +1,286 @@
+#include "instrument.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+namespace instrument {
+
+namespace {
+
+constexpr const char* STAGE_NAMES[STAGE_COUNT] = {
+    "segment", "rs_encode", "rs_decode", "placement",
+    "mask",    "render",    "write",     "read"};
+
+// Оценка квантиля по гистограмме — верхняя граница корзины
+uint64_t quantile(const StageStats& s, double q) {
+    uint64_t target = static_cast<uint64_t>(q * s.calls);
+    uint64_t seen = 0;
+    for (int k = 0; k < HISTOGRAM_BUCKETS; ++k) {
+        seen += s.histogram[k];
+        if (seen > target) return std::min(uint64_t(2) << k, s.max_ns);
+    }
+    return s.max_ns;
+}
+
+bool json_format = false;
+
+void dump() {
+    Summary summary = collect();
+    if (json_format) {
+        print_json(std::cerr, summary);
+    } else {
+        print_summary(std::cerr, summary);
+    }
+}
+
+}  // namespace
+
+const char* stage_name(Stage stage) {
+    return STAGE_NAMES[static_cast<int>(stage)];
+}
+
+#ifdef QR_INSTRUMENTATION
+
+namespace {
+
+// Счётчики потока. Тривиальный тип без динамической инициализации:
+// thread_local-объект обнуляется при создании потока и доступен даже
+// из operator new. Пишет только поток-владелец, collect() читает.
+struct ThreadStats {
+    using Counter = std::atomic<uint64_t>;
+    Counter calls[STAGE_COUNT];
+    Counter total_ns[STAGE_COUNT];
+    Counter max_ns[STAGE_COUNT];
+    Counter histogram[STAGE_COUNT][HISTOGRAM_BUCKETS];
+    // Индекс 0 — выделения вне этапов
+    Counter allocations[STAGE_COUNT + 1];
+    Counter allocated_bytes[STAGE_COUNT + 1];
+    Counter files_written;
+    Counter bytes_written;
+};
+
+thread_local ThreadStats thread_stats;
+thread_local int current_stage = -1;
+
+void bump(std::atomic<uint64_t>& counter, uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value,
+                  std::memory_order_relaxed);
+}
+
+uint64_t read(const std::atomic<uint64_t>& counter) {
+    return counter.load(std::memory_order_relaxed);
+}
+
+void add_to(Summary& summary, const ThreadStats& stats) {
+    bool any = false;
+    for (int s = 0; s < STAGE_COUNT; ++s) {
+        StageStats& out = summary.stages[s];
+        out.calls += read(stats.calls[s]);
+        out.total_ns += read(stats.total_ns[s]);
+        out.max_ns = std::max(out.max_ns, read(stats.max_ns[s]));
+        out.allocations += read(stats.allocations[s + 1]);
+        out.allocated_bytes += read(stats.allocated_bytes[s + 1]);
+        for (int k = 0; k < HISTOGRAM_BUCKETS; ++k) {
+            out.histogram[k] += read(stats.histogram[s][k]);
+        }
+        any = any || read(stats.calls[s]) != 0;
+    }
+    for (int s = 0; s <= STAGE_COUNT; ++s) {
+        summary.allocations += read(stats.allocations[s]);
+        summary.allocated_bytes += read(stats.allocated_bytes[s]);
+    }
+    summary.files_written += read(stats.files_written);
+    summary.bytes_written += read(stats.bytes_written);
+    if (any) ++summary.threads;
+}
+
+// Живые потоки и итог завершившихся. Реестр не разрушается, чтобы
+// потоки могли отписаться и при завершении процесса.
+struct Registry {
+    std::mutex mutex;
+    std::vector<const ThreadStats*> live;
+    Summary retired;
+};
+
+Registry& registry() {
+    static Registry* instance = new Registry;
+    return *instance;
+}
+
+struct Registration {
+    Registration() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.live.push_back(&thread_stats);
+    }
+    ~Registration() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        add_to(r.retired, thread_stats);
+        r.live.erase(std::find(r.live.begin(), r.live.end(), &thread_stats));
+    }
+};
+
+thread_local Registration registration;
+
+// Флаги тривиальны, поэтому доступны из operator new. registering
+// отсекает повторный вход: конструктор Registration сам выделяет память.
+thread_local bool registered = false;
+thread_local bool registering = false;
+
+// Вызывается перед первой записью в thread_stats потока
+void register_thread() {
+    if (registered || registering) return;
+    registering = true;
+    static_cast<void>(&registration);
+    registered = true;
+    registering = false;
+}
+
+int bucket(uint64_t ns) {
+    int k = 0;
+#if defined(__GNUC__) || defined(__clang__)
+    if (ns > 1) k = 63 - __builtin_clzll(ns);
+#else
+    while (ns >>= 1) ++k;
+#endif
+    return std::min(k, HISTOGRAM_BUCKETS - 1);
+}
+
+}  // namespace
+
+namespace detail {
+
+void record_allocation(std::size_t size) {
+    if (enabled()) {
+        register_thread();
+        bump(thread_stats.allocations[current_stage + 1], 1);
+        bump(thread_stats.allocated_bytes[current_stage + 1], size);
+    }
+}
+
+uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+int enter(Stage stage) {
+    int previous = current_stage;
+    current_stage = static_cast<int>(stage);
+    return previous;
+}
+
+void leave(Stage stage, int previous, uint64_t ns) {
+    current_stage = previous;
+    register_thread();
+    int s = static_cast<int>(stage);
+    bump(thread_stats.calls[s], 1);
+    bump(thread_stats.total_ns[s], ns);
+    bump(thread_stats.histogram[s][bucket(ns)], 1);
+    if (ns > read(thread_stats.max_ns[s])) {
+        thread_stats.max_ns[s].store(ns, std::memory_order_relaxed);
+    }
+}
+
+}  // namespace detail
+
+void record_write(size_t bytes) {
+    if (!enabled()) return;
+    register_thread();
+    bump(thread_stats.files_written, 1);
+    bump(thread_stats.bytes_written, bytes);
+}
+
+Summary collect() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    Summary summary = r.retired;
+    for (const ThreadStats* stats : r.live) add_to(summary, *stats);
+    return summary;
+}
+
+#else
+
+Summary collect() { return Summary(); }
+
+#endif  // QR_INSTRUMENTATION
+
+void print_summary(std::ostream& out, const Summary& summary) {
+    if (!compiled_in()) {
+        out << "Инструментирование отключено при сборке (QR_INSTRUMENTATION)"
+            << std::endl;
+        return;
+    }
+    char line[160];
+    std::snprintf(line, sizeof(line),
+                  "%-10s %10s %12s %10s %10s %10s %10s %12s\n", "stage",
+                  "calls", "total_ms", "mean_ns", "p50_ns", "p99_ns", "allocs",
+                  "alloc_bytes");
+    out << line;
+    for (int s = 0; s < STAGE_COUNT; ++s) {
+        const StageStats& st = summary.stages[s];
+        if (st.calls == 0) continue;
+        std::snprintf(line, sizeof(line),
+                      "%-10s %10llu %12.3f %10llu %10llu %10llu %10llu "
+                      "%12llu\n",
+                      STAGE_NAMES[s], static_cast<unsigned long long>(st.calls),
+                      st.total_ns / 1e6,
+                      static_cast<unsigned long long>(st.total_ns / st.calls),
+                      static_cast<unsigned long long>(quantile(st, 0.5)),
+                      static_cast<unsigned long long>(quantile(st, 0.99)),
+                      static_cast<unsigned long long>(st.allocations),
+                      static_cast<unsigned long long>(st.allocated_bytes));
+        out << line;
+    }
+    out << "allocations: " << summary.allocations << " ("
+        << summary.allocated_bytes << " bytes), files written: "
+        << summary.files_written << " (" << summary.bytes_written
+        << " bytes), threads: " << summary.threads << std::endl;
+}
+
+void print_json(std::ostream& out, const Summary& summary) {
+    out << "{\"instrumentation\":" << (compiled_in() ? "true" : "false")
+        << ",\"threads\":" << summary.threads
+        << ",\"allocations\":" << summary.allocations
+        << ",\"allocated_bytes\":" << summary.allocated_bytes
+        << ",\"files_written\":" << summary.files_written
+        << ",\"bytes_written\":" << summary.bytes_written << ",\"stages\":{";
+    bool first = true;
+    for (int s = 0; s < STAGE_COUNT; ++s) {
+        const StageStats& st = summary.stages[s];
+        if (st.calls == 0) continue;
+        out << (first ? "" : ",") << "\"" << STAGE_NAMES[s]
+            << "\":{\"calls\":" << st.calls << ",\"total_ns\":" << st.total_ns
+            << ",\"max_ns\":" << st.max_ns
+            << ",\"p50_ns\":" << quantile(st, 0.5)
+            << ",\"p99_ns\":" << quantile(st, 0.99)
+            << ",\"allocations\":" << st.allocations
+            << ",\"allocated_bytes\":" << st.allocated_bytes
+            << ",\"histogram_log2_ns\":[";
+        int last = HISTOGRAM_BUCKETS - 1;
+        while (last > 0 && st.histogram[last] == 0) --last;
+        for (int k = 0; k <= last; ++k) {
+            out << (k ? "," : "") << st.histogram[k];
+        }
+        out << "]}";
+        first = false;
+    }
+    out << "}}" << std::endl;
+}
+
+void dump_at_exit(bool json) {
+    json_format = json;
+    static bool registered = false;
+    if (!registered) {
+        registered = true;
+        std::atexit(dump);
+    }
+}
+
+}  // namespace instrument
@@ -1,23 +1,321 @@
-#include <bitset>
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
+#include "atlas.h"
+#include "batch.h"
+#include "image_reader.h"
+#include "image_writer.h"
+#include "instrument.h"
 #include "qr_code.h"
+#include "qr_constexpr.h"
 #include "reed_solomon.h"
+#include "server.h"
+#include "structured_append.h"
 
-int main() {
-    std::string input_data = "spotify.com";
+namespace {
 
+void print_usage(const char* program) {
+    std::cerr << "Использование:\n"
+              << "  " << program << "\n"
+              << "  " << program
+              << " --batch [файл|-] [--out DIR] [--threads N]"
+                 " [--ecc L|M|Q|H] [--length-delimited]\n"
+                 "      [--scale N] [--quiet N] [--pbm|--svg] [--cache MB]"
+                 " [--stats text|json] [--verify]\n"
+                 "      [--atlas ФАЙЛ [--columns N] [--rows N]"
+                 " [--margin N]]\n"
+              << "  " << program
+              << " --append [файл|-] --out ФАЙЛ [--ecc L|M|Q|H]"
+                 " [--max-version N] [--threads N]\n"
+                 "      [--scale N] [--quiet N] [--pbm|--svg]"
+                 " [--atlas [--columns N] [--margin N]]\n"
+              << "  " << program << " --read ФАЙЛ...\n"
+              << "  " << program
+              << " --serve ПУТЬ|unix:ПУТЬ|tcp:ПОРТ [--threads N]"
+                 " [--max-batch N] [--cache MB]\n"
+                 "      [--stats text|json]\n";
+}
+
+bool parse_level(const std::string& name, qr_spec::EccLevel& level) {
+    static const char LEVELS[] = "LMQH";
+    for (int i = 0; i < 4; ++i) {
+        if (name.size() == 1 && name[0] == LEVELS[i]) {
+            level = static_cast<qr_spec::EccLevel>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parse_stats(const std::string& format) {
+    if (format != "text" && format != "json") return false;
+    instrument::set_enabled(true);
+    instrument::dump_at_exit(format == "json");
+    return true;
+}
+
+// Все записи входа на листах atlas_file
+int run_atlas(const BatchOptions& batch, AtlasOptions options,
+              const std::string& atlas_file) {
+    std::ifstream file;
+    if (batch.input != "-") {
+        file.open(batch.input, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Cannot open input " + batch.input);
+        }
+    }
+    std::istream& in = batch.input == "-" ? std::cin : file;
+    std::vector<std::string> payloads;
+    std::string payload;
+    while (read_record(in, batch.length_delimited, payload)) {
+        payloads.push_back(std::move(payload));
+    }
+
+    options.threads = batch.threads;
+    options.level = batch.level;
+    options.render = batch.render;
+    AtlasStats stats = write_atlas(payloads, atlas_file, options);
+    std::cout << "Символов: " << stats.symbols << ", ошибок: " << stats.failed
+              << ", листов: " << stats.sheets << ", плитка: " << stats.tile
+              << " пикс., время: " << stats.seconds << " с" << std::endl;
+    return stats.failed == 0 ? 0 : 2;
+}
+
+int run_batch_mode(int argc, char** argv) {
+    BatchOptions options;
+    AtlasOptions atlas;
+    std::string atlas_file;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--out" && i + 1 < argc) {
+            options.output_dir = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            options.threads = std::stoi(argv[++i]);
+        } else if (arg == "--ecc" && i + 1 < argc &&
+                   parse_level(argv[i + 1], options.level)) {
+            ++i;
+        } else if (arg == "--scale" && i + 1 < argc) {
+            options.render.scale = std::stoi(argv[++i]);
+        } else if (arg == "--quiet" && i + 1 < argc) {
+            options.render.quiet_zone = std::stoi(argv[++i]);
+        } else if (arg == "--cache" && i + 1 < argc) {
+            options.cache_bytes = std::stoul(argv[++i]) << 20;
+        } else if (arg == "--pbm") {
+            options.render.format = ImageFormat::PBM;
+        } else if (arg == "--svg") {
+            options.render.format = ImageFormat::SVG;
+        } else if (arg == "--atlas" && i + 1 < argc) {
+            atlas_file = argv[++i];
+        } else if (arg == "--columns" && i + 1 < argc) {
+            atlas.columns = std::stoi(argv[++i]);
+        } else if (arg == "--rows" && i + 1 < argc) {
+            atlas.rows = std::stoi(argv[++i]);
+        } else if (arg == "--margin" && i + 1 < argc) {
+            atlas.margin = std::stoi(argv[++i]);
+        } else if (arg == "--verify") {
+            options.verify = true;
+        } else if (arg == "--length-delimited") {
+            options.length_delimited = true;
+        } else if (arg == "--stats" && i + 1 < argc &&
+                   parse_stats(argv[i + 1])) {
+            ++i;
+        } else if (arg[0] != '-' || arg == "-") {
+            options.input = arg;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!atlas_file.empty()) return run_atlas(options, atlas, atlas_file);
+
+    BatchStats stats = run_batch(options);
+    std::cout << "Записей: " << stats.records << ", ошибок: " << stats.failed
+              << ", время: " << stats.seconds << " с, "
+              << (stats.seconds > 0 ? stats.records / stats.seconds : 0)
+              << " кодов/с" << std::endl;
+    if (options.cache_bytes > 0) {
+        std::cout << "Кэш: попаданий " << stats.cache_hits << ", промахов "
+                  << stats.cache_misses << std::endl;
+    }
+    return stats.failed == 0 ? 0 : 2;
+}
+
+// Всё содержимое входа — одно сообщение, разбитое на символы Structured
+// Append: файлы частей или один лист атласа
+int run_append_mode(int argc, char** argv) {
+    AppendOptions options;
+    AtlasOptions atlas;
+    std::string input = "-";
+    std::string output;
+    bool to_atlas = false;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--out" && i + 1 < argc) {
+            output = argv[++i];
+        } else if (arg == "--ecc" && i + 1 < argc &&
+                   parse_level(argv[i + 1], options.level)) {
+            ++i;
+        } else if (arg == "--max-version" && i + 1 < argc) {
+            options.max_version = std::stoi(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            options.threads = std::stoi(argv[++i]);
+        } else if (arg == "--scale" && i + 1 < argc) {
+            options.render.scale = std::stoi(argv[++i]);
+        } else if (arg == "--quiet" && i + 1 < argc) {
+            options.render.quiet_zone = std::stoi(argv[++i]);
+        } else if (arg == "--pbm") {
+            options.render.format = ImageFormat::PBM;
+        } else if (arg == "--svg") {
+            options.render.format = ImageFormat::SVG;
+        } else if (arg == "--atlas") {
+            to_atlas = true;
+        } else if (arg == "--columns" && i + 1 < argc) {
+            atlas.columns = std::stoi(argv[++i]);
+        } else if (arg == "--margin" && i + 1 < argc) {
+            atlas.margin = std::stoi(argv[++i]);
+        } else if (arg[0] != '-' || arg == "-") {
+            input = arg;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (output.empty()) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::ifstream file;
+    if (input != "-") {
+        file.open(input, std::ios::binary);
+        if (!file) throw std::runtime_error("Cannot open input " + input);
+    }
+    std::istream& in = input == "-" ? std::cin : file;
+    std::string message((std::istreambuf_iterator<char>(in)),
+                        std::istreambuf_iterator<char>());
+
+    if (to_atlas) {
+        atlas.threads = options.threads;
+        atlas.level = options.level;
+        atlas.render = options.render;
+        atlas.structured_append = true;
+        std::vector<std::string> parts =
+            split_message(message, options.level, options.max_version);
+        AtlasStats stats = write_atlas(parts, output, atlas);
+        std::cout << "Частей: " << stats.symbols << ", плитка: " << stats.tile
+                  << " пикс., время: " << stats.seconds << " с" << std::endl;
+        return 0;
+    }
+    AppendStats stats = write_append_files(message, output, options);
+    std::cout << "Частей: " << stats.parts << ", наибольшая версия: "
+              << stats.max_version << ", байтов: " << stats.bytes
+              << ", время: " << stats.seconds << " с" << std::endl;
+    return 0;
+}
+
+int run_serve_mode(int argc, char** argv) {
+    server::ServerOptions options;
+    if (argc < 3) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    options.address = argv[2];
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            options.threads = std::stoi(argv[++i]);
+        } else if (arg == "--max-batch" && i + 1 < argc) {
+            options.max_batch = std::stoul(argv[++i]);
+        } else if (arg == "--cache" && i + 1 < argc) {
+            options.cache_bytes = std::stoul(argv[++i]) << 20;
+        } else if (arg == "--stats" && i + 1 < argc &&
+                   parse_stats(argv[i + 1])) {
+            ++i;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    server::ServerStats stats = server::run_server(options);
+    std::cout << "Соединений: " << stats.connections << ", запросов: "
+              << stats.requests << ", ошибок: " << stats.failed
+              << ", пакетов: " << stats.batches << std::endl;
+    return 0;
+}
+
+// Печатает содержимое каждого файла; ошибки чтения не прерывают обход
+int run_read_mode(int argc, char** argv) {
     ReedSolomon solomon;
-    ReedSolomon::Code msg = solomon.encode(input_data);
+    QRMatrix matrix;
+    int failed = 0;
+    for (int i = 2; i < argc; ++i) {
+        try {
+            read_image_file(argv[i], matrix);
+            DecodedSymbol symbol = decode_symbol(matrix, solomon);
+            std::cout << argv[i] << ": версия " << symbol.version
+                      << ", уровень " << "LMQH"[static_cast<int>(symbol.level)]
+                      << ", маска " << symbol.mask << ", исправлено "
+                      << symbol.correction.errors;
+            if (symbol.append.total > 0) {
+                std::cout << ", часть " << symbol.append.index + 1 << " из "
+                          << symbol.append.total << ", чётность "
+                          << static_cast<int>(symbol.append.parity);
+            }
+            std::cout << ": " << symbol.payload << std::endl;
+        } catch (const std::exception& e) {
+            std::cerr << argv[i] << ": " << e.what() << std::endl;
+            ++failed;
+        }
+    }
+    return failed == 0 ? 0 : 2;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc > 1) {
+        if (std::strcmp(argv[1], "--batch") == 0) {
+            try {
+                return run_batch_mode(argc, argv);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+        }
+        if (std::strcmp(argv[1], "--append") == 0) {
+            try {
+                return run_append_mode(argc, argv);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+        }
+        if (std::strcmp(argv[1], "--read") == 0 && argc > 2) {
+            return run_read_mode(argc, argv);
+        }
+        if (std::strcmp(argv[1], "--serve") == 0) {
+            try {
+                return run_serve_mode(argc, argv);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+        }
+        print_usage(argv[0]);
+        return 1;
+    }
 
-    QRCode qr;
-    std::vector<std::vector<int>> qr_code = qr.generate(msg);
+    // Символ строится при компиляции и лежит в бинарнике готовым
+    static constexpr qr::Symbol SYMBOL = qr::make("spotify.com");
 
-    save_qr_to_ppm(qr_code, "qr_code.ppm");
+    save_qr_to_ppm(SYMBOL.matrix, "qr_code.ppm");
 
     std::cout << "QR-код сохранён в файл qr_code.ppm" << std::endl;
 
@@ -1,151 +1,222 @@
 #include "qr_code.h"
 
-std::vector<std::vector<int>> QRCode::generate(std::vector<int> message) {
-    std::vector<std::pair<int, int>> sequence = generate_module_sequence();
-    fill_matrix_by_message(message, sequence);
-    apply_mask();
-    generate_spec_lines();
-    return qr_code_;
-}
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
 
-bool QRCode::mask_fn(int row, int column) {
-    switch (MASK_INDEX) {
-        case 0:
-            return (row + column) % 2 == 0;
-        case 1:
-            return row % 2 == 0;
-        case 2:
-            return column % 3 == 0;
-        case 3:
-            return (row + column) % 3 == 0;
-        case 4:
-            return ((row / 2) + (column / 3)) % 2 == 0;
-        case 5:
-            return ((row * column) % 2 + (row * column) % 3) == 0;
-        case 6:
-            return (((row * column) % 2) + ((row * column) % 3)) % 2 == 0;
-        case 7:
-            return (((row + column) % 2) + ((row * column) % 3)) % 2 == 0;
-        default:
-            return false;
-    }
+#include "instrument.h"
+#include "qr_layout.h"
+
+// Шаблон версии строится один раз на процесс при первом обращении
+const QRCode::Template& QRCode::get_template(int version) {
+    static std::once_flag flags[qr_spec::MAX_VERSION + 1];
+    static std::unique_ptr<Template> templates[qr_spec::MAX_VERSION + 1];
+    std::call_once(flags[version], [version] {
+        templates[version].reset(new Template(build_template(version)));
+    });
+    return *templates[version];
 }
 
-std::vector<std::pair<int, int>> QRCode::generate_module_sequence() {
-    std::vector<std::vector<int>> matrix(SIZE, std::vector<int>(SIZE, 0));
-    fill_service_info(matrix);
+QRCode::Template QRCode::build_template(int version) {
+    int size = qr_spec::symbol_size(version);
+    Template tmpl;
+    tmpl.version = version;
+    tmpl.reserved.reset(size);
+    tmpl.patterns.reset(size);
 
-    std::vector<std::pair<int, int>> sequence;
-    int row_step = -1;
-    int row = SIZE - 1;
-    int column = SIZE - 1;
-    int index = 0;
-    while (column >= 0) {
-        if (matrix[row][column] == 0) {
-            sequence.push_back({row, column});
-        }
-        if (index % 2 == 1) {
-            row += row_step;
-            if (row == -1 || row == SIZE) {
-                row_step = -row_step;
-                row += row_step;
-                column -= column == 7 ? 2 : 1;
-            } else {
-                column += 1;
+    fill_service_info(version, tmpl.reserved);
+    generate_spec_lines(version, tmpl.patterns);
+    for (int mask = 0; mask < MASK_COUNT; ++mask) {
+        QRMatrix& plane = tmpl.mask_planes[mask];
+        plane.reset(size);
+        for (int row = 0; row < size; ++row) {
+            for (int column = 0; column < size; ++column) {
+                if (!tmpl.reserved.get(row, column) &&
+                    mask_fn(mask, row, column)) {
+                    plane.set(row, column);
+                }
             }
-        } else {
-            column -= 1;
         }
-        index++;
     }
-    return sequence;
+    for (const auto& module : generate_module_sequence(tmpl.reserved)) {
+        tmpl.placement.push_back(static_cast<uint16_t>(
+            module.first * tmpl.reserved.stride() * QRMatrix::WORD_BITS +
+            module.second));
+    }
+    return tmpl;
 }
 
-void fill_area(std::vector<std::vector<int>>& matrix, int row, int column,
-               int width, int height, int fill = 1) {
-    std::vector<int> fill_row(width, fill);
-    for (int i = row; i < row + height; ++i) {
-        std::memcpy(&matrix[i][column], fill_row.data(), width * sizeof(int));
+int QRCode::generate(const uint8_t* codewords, size_t n, QRMatrix& out,
+                     EccLevel level, int mask) const {
+    int version = qr_spec::version_for_codewords(static_cast<int>(n));
+    if (version == 0) {
+        throw std::runtime_error("Codeword count matches no QR version");
+    }
+    if (mask != AUTO_MASK && (mask < 0 || mask >= MASK_COUNT)) {
+        throw std::runtime_error("Invalid mask index");
     }
+    const Template& tmpl = get_template(version);
+    {
+        instrument::ScopedStage stage(instrument::Stage::PLACEMENT);
+        out.copy_from(tmpl.patterns);
+        fill_matrix_by_message(tmpl, codewords, n, out);
+    }
+    instrument::ScopedStage stage(instrument::Stage::MASK);
+    if (mask == AUTO_MASK) {
+        mask = select_mask(tmpl, level, out);
+    }
+    apply_data_mask(tmpl, mask, out);
+    apply_mask(level, mask, out);
+    return mask;
+}
+
+QRMatrix QRCode::generate(const std::vector<uint8_t>& message,
+                          EccLevel level) const {
+    QRMatrix out;
+    generate(message.data(), message.size(), out, level);
+    return out;
+}
+
+bool QRCode::mask_fn(int mask, int row, int column) {
+    return qr_layout::mask_bit(mask, row, column);
+}
+
+std::vector<std::pair<int, int>> QRCode::generate_module_sequence(
+    const QRMatrix& matrix) {
+    std::vector<std::pair<int, int>> sequence;
+    qr_layout::walk_data_modules(matrix, [&](int row, int column) {
+        sequence.push_back({row, column});
+    });
+    return sequence;
 }
 
-void QRCode::fill_service_info(std::vector<std::vector<int>>& matrix) {
-    fill_area(matrix, 0, 0, 9, 9);
-    fill_area(matrix, 0, SIZE - 8, 8, 9);
-    fill_area(matrix, SIZE - 8, 0, 9, 8);
-    fill_area(matrix, 6, 9, 4, 1);
-    fill_area(matrix, 9, 6, 1, 4);
-    matrix[SIZE - 8][8] = 1;
+void QRCode::fill_service_info(int version, QRMatrix& matrix) {
+    qr_layout::fill_reserved(version, matrix);
 }
 
-void QRCode::fill_matrix_by_message(
-    const std::vector<int>& message,
-    std::vector<std::pair<int, int>>& sequence) {
-    for (size_t index = 0; index < sequence.size(); ++index) {
-        int row = sequence[index].first;
-        int col = sequence[index].second;
-
-        int codeword = message[index / 8];
-        int bit_index = index % 8;
-        std::bitset<8> bit(codeword);
-        int bit_int = bit[7 - bit_index];
-        qr_code_[row][col] = bit[7 - bit_index] ^ mask_fn(row, col);
+// Биты данных раскладываются по готовой таблице адресов в словах матрицы;
+// служебные модули шаблона в этих позициях нулевые
+// (остаточные биты в конце последовательности остаются нулевыми)
+void QRCode::fill_matrix_by_message(const Template& tmpl,
+                                    const uint8_t* message, size_t n,
+                                    QRMatrix& out) {
+    QRMatrix::Word* words = out.data();
+    const uint16_t* placement = tmpl.placement.data();
+    size_t count = n * 8;
+    for (size_t index = 0; index < count; ++index) {
+        QRMatrix::Word bit = (message[index / 8] >> (7 - index % 8)) & 1;
+        uint16_t pos = placement[index];
+        words[pos / QRMatrix::WORD_BITS] |= bit << (pos % QRMatrix::WORD_BITS);
     }
 }
 
-// Маскирование
-void QRCode::apply_mask() {
-    for (size_t i = 0; i < 8; i++) {
-        if (i >= 6) {
-            qr_code_[8][i + 1] = mask_lines[MASK_INDEX][0][i];
-        } else {
-            qr_code_[8][i] = mask_lines[MASK_INDEX][0][i];
-        }
+// Маска накладывается на область данных целыми словами
+void QRCode::apply_data_mask(const Template& tmpl, int mask, QRMatrix& out) {
+    const QRMatrix::Word* plane = tmpl.mask_planes[mask].data();
+    QRMatrix::Word* words = out.data();
+    for (size_t i = 0; i < out.word_count(); ++i) {
+        words[i] ^= plane[i];
+    }
+}
 
-        qr_code_[20 - i][8] = mask_lines[MASK_INDEX][0][i];
-        if (i >= 6) {
-            qr_code_[i + 1][8] = mask_lines[MASK_INDEX][1][i];
-        } else {
-            qr_code_[i][8] = mask_lines[MASK_INDEX][1][i];
+// Перебор всех восьми масок: кандидат собирается из немаскированной
+// матрицы XOR готовой битовой плоскостью и оценивается целыми словами
+int QRCode::select_mask(const Template& tmpl, EccLevel level,
+                        const QRMatrix& unmasked) {
+    QRMatrix candidate;
+    int best_mask = 0;
+    int best_score = 0;
+    for (int mask = 0; mask < MASK_COUNT; ++mask) {
+        candidate.copy_from(unmasked);
+        apply_data_mask(tmpl, mask, candidate);
+        apply_mask(level, mask, candidate);
+        int score = penalty(candidate);
+        if (mask == 0 || score < best_score) {
+            best_mask = mask;
+            best_score = score;
         }
-        qr_code_[8][20 - i] = mask_lines[MASK_INDEX][1][i];
     }
+    return best_mask;
 }
 
-void QRCode::generate_spec_lines() {
-    int l = qr_code_.size();
+int QRCode::penalty(const QRMatrix& matrix) {
+    return qr_layout::penalty(matrix);
+}
 
-    // Добавление линий синхронизации
-    for (int i = 8; i <= 12; i += 2) {
-        qr_code_[6][i] = 1;
-        qr_code_[i][6] = 1;
-    }
+void QRCode::apply_mask(EccLevel level, int mask, QRMatrix& out) {
+    qr_layout::write_format(level, mask, out);
+}
 
-    // Создание маркеров позиционирования в углах
-    for (int i = 0; i < 7; i++) {
-        qr_code_[0][i] = 1;
-        qr_code_[6][i] = 1;
-        qr_code_[i][0] = 1;
-        qr_code_[i][6] = 1;
-        qr_code_[l - 1][i] = 1;
-        qr_code_[l - 7][i] = 1;
-        qr_code_[i][l - 1] = 1;
-        qr_code_[i][l - 7] = 1;
-        qr_code_[l - i - 1][0] = 1;
-        qr_code_[l - i - 1][6] = 1;
-        qr_code_[0][l - i - 1] = 1;
-        qr_code_[6][l - i - 1] = 1;
+bool QRCode::read_format(const QRMatrix& symbol, EccLevel& level,
+                         int& mask) {
+    int size = symbol.size();
+    int first = 0;
+    int second = 0;
+    for (int i = 0; i < 15; ++i) {
+        bool bit;
+        if (i < 6) {
+            bit = symbol.get(i, 8);
+        } else if (i < 8) {
+            bit = symbol.get(i + 1, 8);
+        } else if (i == 8) {
+            bit = symbol.get(8, 7);
+        } else {
+            bit = symbol.get(8, 14 - i);
+        }
+        first |= bit << i;
+        bit = i < 8 ? symbol.get(8, size - 1 - i)
+                    : symbol.get(size - 15 + i, 8);
+        second |= bit << i;
+    }
+    int best = 16;
+    for (int l = 0; l < 4; ++l) {
+        for (int m = 0; m < MASK_COUNT; ++m) {
+            int code = qr_spec::format_bits(static_cast<EccLevel>(l), m);
+            int distance = std::min(QRMatrix::popcount(code ^ first),
+                                    QRMatrix::popcount(code ^ second));
+            if (distance < best) {
+                best = distance;
+                level = static_cast<EccLevel>(l);
+                mask = m;
+            }
+        }
     }
+    return best <= 3;
+}
 
-    // Заполнение внутренних квадратов маркеров
-    for (int i = 2; i < 5; i++) {
-        for (int j = 2; j < 5; j++) {
-            qr_code_[i][j] = 1;
-            qr_code_[l - i - 1][j] = 1;
-            qr_code_[i][l - j - 1] = 1;
+// Бит модуля — XOR символа с плоскостью маски по адресам шаблона
+size_t QRCode::read_codewords(const QRMatrix& symbol, uint8_t* out,
+                              EccLevel& level, int& mask) {
+    int size = symbol.size();
+    int version = (size - 17) / 4;
+    if (version < 1 || version > qr_spec::MAX_VERSION ||
+        qr_spec::symbol_size(version) != size) {
+        throw std::runtime_error("Invalid symbol size");
+    }
+    if (!read_format(symbol, level, mask)) {
+        throw std::runtime_error("Unreadable format information");
+    }
+    const Template& tmpl = get_template(version);
+    const QRMatrix::Word* words = symbol.data();
+    const QRMatrix::Word* plane = tmpl.mask_planes[mask].data();
+    const uint16_t* placement = tmpl.placement.data();
+    size_t n = qr_spec::total_codewords(version);
+    for (size_t k = 0; k < n; ++k) {
+        unsigned byte = 0;
+        for (int b = 0; b < 8; ++b) {
+            uint16_t pos = placement[k * 8 + b];
+            size_t w = pos / QRMatrix::WORD_BITS;
+            byte = byte << 1 |
+                   static_cast<unsigned>(
+                       ((words[w] ^ plane[w]) >> (pos % QRMatrix::WORD_BITS)) &
+                       1);
         }
+        out[k] = static_cast<uint8_t>(byte);
     }
+    return n;
+}
 
-    // Дополнительный черный модуль
-    qr_code_[13][8] = 1;
+void QRCode::generate_spec_lines(int version, QRMatrix& out) {
+    qr_layout::draw_patterns(version, out);
 }
@@ -0,0 +1,182 @@
+#include "qrcode.h"
+
+#include <cstring>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include "image_writer.h"
+#include "qr_code.h"
+#include "qr_spec.h"
+#include "reed_solomon.h"
+
+namespace {
+
+constexpr int64_t MAX_IMAGE_SIDE = 1 << 16;  // пикселей вместе с рамкой
+
+bool valid(const qrc_options &options) {
+    return options.level >= QRC_LEVEL_L && options.level <= QRC_LEVEL_H &&
+           options.format >= QRC_FORMAT_MODULES &&
+           options.format <= QRC_FORMAT_SVG && options.mask >= -1 &&
+           options.mask <= 7 && options.scale >= 1 && options.quiet_zone >= 0;
+}
+
+// Кодирует сообщения пачки по одному; объекты и буферы общие для всей
+// пачки, поэтому выделения памяти идут только на первых сообщениях
+class BatchEncoder {
+   public:
+    explicit BatchEncoder(const qrc_options &options)
+        : level_(static_cast<qr_spec::EccLevel>(options.level)),
+          mask_(options.mask),
+          format_(options.format) {
+        render_.scale = options.scale;
+        render_.quiet_zone = options.quiet_zone;
+        render_.format = format_ == QRC_FORMAT_PBM   ? ImageFormat::PBM
+                         : format_ == QRC_FORMAT_SVG ? ImageFormat::SVG
+                                                     : ImageFormat::PPM;
+    }
+
+    // Заполняет всё в result, кроме offset; байты остаются в bytes()
+    int32_t encode(const char *payload, size_t length, qrc_result &result) {
+        message_.assign(payload, length);
+        ReedSolomon::Code code;
+        try {
+            code = solomon_.encode(message_, level_);
+        } catch (const std::bad_alloc &) {
+            throw;
+        } catch (const std::exception &) {
+            return QRC_ENCODE_FAILED;
+        }
+        result.mask = qr_.generate(code.data(), code.size(), matrix_, level_,
+                                   mask_);
+        result.size = matrix_.size();
+        result.version =
+            qr_spec::version_for_codewords(static_cast<int>(code.size()));
+
+        int size = matrix_.size();
+        if (format_ == QRC_FORMAT_MODULES) {
+            bytes_.resize(static_cast<size_t>(size) * size);
+            for (int r = 0; r < size; ++r) {
+                for (int c = 0; c < size; ++c) {
+                    bytes_[static_cast<size_t>(r) * size + c] =
+                        matrix_.get(r, c) ? 1 : 0;
+                }
+            }
+        } else {
+            int64_t side =
+                (size + 2 * int64_t(render_.quiet_zone)) * render_.scale;
+            if (side > MAX_IMAGE_SIDE && format_ != QRC_FORMAT_SVG) {
+                return QRC_INVALID_ARGUMENT;
+            }
+            render_image(matrix_, render_, bytes_);
+        }
+        result.length = bytes_.size();
+        return QRC_OK;
+    }
+
+    const std::vector<uint8_t> &bytes() const { return bytes_; }
+
+   private:
+    qr_spec::EccLevel level_;
+    int mask_;
+    int format_;
+    RenderOptions render_;
+    ReedSolomon solomon_;
+    QRCode qr_;
+    QRMatrix matrix_;
+    std::string message_;
+    std::vector<uint8_t> bytes_;
+};
+
+}  // namespace
+
+extern "C" {
+
+int32_t qrc_abi_version(void) { return QRC_ABI_VERSION; }
+
+void qrc_default_options(qrc_options *options) {
+    if (options == nullptr) return;
+    options->level = QRC_LEVEL_L;
+    options->format = QRC_FORMAT_MODULES;
+    options->mask = QRCode::AUTO_MASK;
+    options->scale = 10;
+    options->quiet_zone = 0;
+}
+
+int32_t qrc_encode_batch(const char *const *payloads, const size_t *lengths,
+                         size_t count, const qrc_options *options,
+                         uint8_t *arena, size_t arena_size,
+                         qrc_result *results, size_t *required) {
+    qrc_options defaults;
+    qrc_default_options(&defaults);
+    if (options == nullptr) options = &defaults;
+    if ((count > 0 && (payloads == nullptr || lengths == nullptr ||
+                       results == nullptr)) ||
+        (arena == nullptr && arena_size > 0) || !valid(*options)) {
+        return QRC_INVALID_ARGUMENT;
+    }
+    try {
+        BatchEncoder encoder(*options);
+        size_t used = 0;
+        bool overflow = false;
+        for (size_t i = 0; i < count; ++i) {
+            qrc_result &result = results[i];
+            result = qrc_result{};
+            if (payloads[i] == nullptr && lengths[i] > 0) {
+                result.status = QRC_INVALID_ARGUMENT;
+                continue;
+            }
+            result.status = encoder.encode(
+                payloads[i] != nullptr ? payloads[i] : "", lengths[i], result);
+            if (result.status != QRC_OK) continue;
+
+            // После первого непоместившегося сообщения арена не пишется,
+            // чтобы смещения совпали с повторным вызовом на большей арене
+            const std::vector<uint8_t> &bytes = encoder.bytes();
+            result.offset = used;
+            if (!overflow && bytes.size() <= arena_size - used) {
+                std::memcpy(arena + used, bytes.data(), bytes.size());
+            } else {
+                overflow = true;
+                result.status = QRC_BUFFER_TOO_SMALL;
+            }
+            used += bytes.size();
+        }
+        if (required != nullptr) *required = used;
+        return overflow ? QRC_BUFFER_TOO_SMALL : QRC_OK;
+    } catch (...) {
+        return QRC_INTERNAL_ERROR;
+    }
+}
+
+int32_t qrc_encode(const char *payload, size_t length,
+                   const qrc_options *options, uint8_t *out, size_t capacity,
+                   qrc_result *result) {
+    qrc_result local{};
+    int32_t status = qrc_encode_batch(&payload, &length, 1, options, out,
+                                      capacity, &local, nullptr);
+    if (status == QRC_INVALID_ARGUMENT || status == QRC_INTERNAL_ERROR) {
+        return status;
+    }
+    if (result != nullptr) *result = local;
+    return local.status;
+}
+
+const char *qrc_status_string(int32_t status) {
+    switch (status) {
+        case QRC_OK:
+            return "OK";
+        case QRC_INVALID_ARGUMENT:
+            return "Invalid argument";
+        case QRC_ENCODE_FAILED:
+            return "Message too long";
+        case QRC_BUFFER_TOO_SMALL:
+            return "Output buffer too small";
+        case QRC_INTERNAL_ERROR:
+            return "Internal error";
+        default:
+            return "Unknown status";
+    }
+}
+
+}  // extern "C"
@@ -1,374 +1,327 @@
 #include "reed_solomon.h"
 
-#include <bitset>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
 
-ReedSolomon::ReedSolomon() : gf_exp_(512, 0), gf_log_(256, 0) { init_tables(); }
+#include "bit_writer.h"
+#include "instrument.h"
 
-void ReedSolomon::init_tables() {
-    int x = 1;
-    for (int i = 0; i < 255; ++i) {
-        gf_exp_[i] = x;
-        gf_log_[x] = i;
-        x = gf_mult_noLUT(x, 2);
-    }
-
-    for (int i = 255; i < 512; ++i) {
-        gf_exp_[i] = gf_exp_[i - 255];
-    }
+ReedSolomon::Code ReedSolomon::encode(std::string message,
+                                     EccLevel level) {
+    return encode_symbol(message, level, nullptr);
 }
 
-int ReedSolomon::gf_mult_noLUT(int x, int y) {
-    int r = 0;
-    while (y > 0) {
-        if (y & 1) r ^= x;
-        y >>= 1;
-        x <<= 1;
-        if (x & 0x100) x ^= PRIMITIVE;
+ReedSolomon::Code ReedSolomon::encode(const std::string& message,
+                                     EccLevel level,
+                                     const qr_segment::AppendHeader& header) {
+    if (header.total < 1 || header.total > qr_segment::MAX_APPEND_SYMBOLS ||
+        header.index < 0 || header.index >= header.total) {
+        throw std::runtime_error("Invalid structured append header");
     }
-    return r;
+    return encode_symbol(message, level, &header);
 }
 
-int ReedSolomon::gf_mul(int x, int y) {
-    if (x == 0 || y == 0) return 0;
-    return gf_exp_[(gf_log_[x] + gf_log_[y]) % 255];
+ReedSolomon::Code ReedSolomon::encode_symbol(
+    const std::string& message, EccLevel level,
+    const qr_segment::AppendHeader* header) {
+    std::vector<qr_segment::Segment> segments;
+    uint8_t data[qr_spec::MAX_DATA_CODEWORDS];
+    int version;
+    {
+        instrument::ScopedStage stage(instrument::Stage::SEGMENT);
+        version = choose_version(message, level, &segments, header != nullptr);
+        get_code(message, segments, version, level, data, header);
+    }
+    instrument::ScopedStage stage(instrument::Stage::RS_ENCODE);
+    Code code(qr_spec::total_codewords(version));
+    encode_message(data, version, level, code.data());
+    return code;
 }
 
-int ReedSolomon::gf_div(int x, int y) {
-    if (y == 0) throw std::runtime_error("Division by zero");
-    if (x == 0) return 0;
-    int result = gf_exp_[(gf_log_[x] + 255 - gf_log_[y]) % 255];
-    return result;
+int ReedSolomon::choose_version(const std::string& message, EccLevel level,
+                                std::vector<qr_segment::Segment>* segments,
+                                bool structured_append) {
+    std::vector<qr_segment::Segment> local;
+    return qr_segment::choose_version(
+        reinterpret_cast<const uint8_t*>(message.data()), message.size(),
+        level, segments ? *segments : local,
+        structured_append ? qr_segment::APPEND_HEADER_BITS : 0);
 }
 
-int ReedSolomon::gf_pow(int x, int power) {
-    if (power == 0) return 1;
-    if (x == 0) return 0;
-    int result = gf_exp_[(gf_log_[x] * power) % 255];
-    return result;
+void ReedSolomon::get_code(const std::string& message,
+                           const std::vector<qr_segment::Segment>& segments,
+                           int version, EccLevel level, uint8_t* out,
+                           const qr_segment::AppendHeader* header) {
+    size_t capacity = qr_spec::data_codewords(version, level);
+    BitWriter writer(out, capacity);
+    if (header) qr_segment::write_append_header(writer, *header);
+    qr_segment::write(writer, reinterpret_cast<const uint8_t*>(message.data()),
+                      segments, version);
+    writer.pad(capacity);
 }
 
-int ReedSolomon::gf_inverse(int x) {
-    if (x == 0) throw std::runtime_error("Cannot compute inverse of zero");
-    return gf_exp_[255 - gf_log_[x]];
-}
-
-int ReedSolomon::gf_poly_eval(const std::vector<int>& poly, int x) {
-    int y = poly[0];
-    for (size_t i = 1; i < poly.size(); ++i) {
-        y = gf_mul(y, x) ^ poly[i];
+void ReedSolomon::encode_message(const uint8_t* data, int version,
+                                 EccLevel level, uint8_t* out) const {
+    int blocks = qr_spec::num_blocks(version, level);
+    for (int b = 0; b < blocks; ++b) {
+        encode_message_block(data, version, level, b, out);
     }
-    return y;
 }
 
-std::vector<int> ReedSolomon::gf_poly_add(const std::vector<int>& p,
-                                          const std::vector<int>& q) {
-    size_t max_len = std::max(p.size(), q.size());
-    std::vector<int> r(max_len, 0);
-    for (size_t i = 0; i < p.size(); ++i) {
-        r[i + max_len - p.size()] = p[i];
+void ReedSolomon::encode_message_block(const uint8_t* data, int version,
+                                       EccLevel level, int block,
+                                       uint8_t* out) const {
+    qr_spec::BlockLayout layout = qr_spec::block_layout(version, level);
+    const uint8_t* block_data = data + layout.data_offset(block);
+    int length = layout.data_length(block);
+    uint8_t ecc[MAX_ECC_LENGTH];
+    encode_block(block_data, length, layout.ecc, ecc);
+    for (int i = 0; i < length; ++i) {
+        out[layout.data_position(block, i)] = block_data[i];
     }
-    for (size_t i = 0; i < q.size(); ++i) {
-        r[i + max_len - q.size()] ^= q[i];
-    }
-    return r;
-}
-
-std::vector<int> ReedSolomon::gf_poly_scale(const std::vector<int>& p, int x) {
-    std::vector<int> r(p.size());
-    for (size_t i = 0; i < p.size(); ++i) {
-        r[i] = gf_mul(p[i], x);
+    for (int j = 0; j < layout.ecc; ++j) {
+        out[layout.ecc_position(block, j)] = ecc[j];
     }
-    return r;
 }
 
-std::vector<int> ReedSolomon::gf_poly_mul(const std::vector<int>& p,
-                                          const std::vector<int>& q) {
-    std::vector<int> r(p.size() + q.size() - 1, 0);
-    for (size_t j = 0; j < q.size(); ++j) {
-        for (size_t i = 0; i < p.size(); ++i) {
-            r[i + j] ^= gf_mul(p[i], q[j]);
-        }
+void ReedSolomon::encode_block(const uint8_t* data, size_t n, int nsym,
+                               uint8_t* ecc_out) const {
+    if (nsym < 1 || nsym > MAX_ECC_LENGTH) {
+        throw std::runtime_error("Unsupported ECC length");
     }
-    return r;
+    gf256::rs_remainder(data, n, nsym, ecc_out);
 }
 
-std::pair<std::vector<int>, std::vector<int>> ReedSolomon::gf_poly_div(
-    const std::vector<int>& dividend, const std::vector<int>& divisor) {
-    std::vector<int> msg_out = dividend;
-    int len_diff = msg_out.size() - divisor.size();
-    std::vector<int> coeffs(len_diff + 1, 0);
-    for (int i = 0; i <= len_diff; ++i) {
-        int coef = msg_out[i];
-        if (coef != 0) {
-            for (size_t j = 1; j < divisor.size(); ++j) {
-                if (divisor[j] != 0) {
-                    msg_out[i + j] ^= gf_mul(divisor[j], coef);
-                }
-            }
-        }
-        coeffs[i] = coef;
-    }
-    std::vector<int> remainder(msg_out.begin() + len_diff + 1, msg_out.end());
-    return {coeffs, remainder};
-}
+// Многочлены декодера хранятся младшим коэффициентом вперёд, позиция p
+// сообщения длины n соответствует степени n - 1 - p.
 
-ReedSolomon::Code ReedSolomon::encode(std::string message) {
-    Code code = get_code(message);
-    return encode_message(code);
+bool ReedSolomon::calc_syndromes(const uint8_t* msg, size_t n, int nsym,
+                                 uint8_t* synd) {
+    return gf256::syndromes(msg, n, nsym, synd);
 }
 
-ReedSolomon::Code ReedSolomon::get_code(std::string message) {
-    std::vector<std::string> bin_code;
-    for (char c : message) {
-        std::bitset<8> b(c);
-        bin_code.push_back(b.to_string());
-    }
-    std::string mode = "0100";
-    std::bitset<8> data_len_bits(message.size());
-    std::string data_len = data_len_bits.to_string();
-    std::string terminator = "0000";
-    std::string code = mode + data_len + "";
-    for (auto& s : bin_code) {
-        code += s;
-    }
-    code += terminator;
-    while (code.size() < 152) {
-        if (code.size() >= 16 &&
-            code.substr(code.size() - 8, 8) == "00010001") {
-            code += "11101100";
-        } else {
-            code += "00010001";
+int ReedSolomon::find_errors_locator(const int* pos, int count, size_t n,
+                                     uint8_t* loc) {
+    std::memset(loc, 0, SCRATCH_SIZE);
+    loc[0] = 1;
+    // Умножение на (1 + X x) для каждой позиции
+    for (int k = 0; k < count; ++k) {
+        int x = gf256::exp(static_cast<int>(n - 1 - pos[k]));
+        for (int i = k + 1; i > 0; --i) {
+            loc[i] ^= gf256::mul(loc[i - 1], x);
         }
     }
-    std::vector<int> result;
-    for (size_t i = 0; i < code.size(); i += 8) {
-        std::bitset<8> byte(code.substr(i, 8));
-        result.push_back((int)byte.to_ulong());
-    }
-    return result;
-}
-
-std::vector<int> ReedSolomon::encode_message(const std::vector<int>& msg_in) {
-    std::vector<int> gen = generator_poly();
-    std::vector<int> padded_msg = msg_in;
-    padded_msg.resize(msg_in.size() + gen.size() - 1, 0);
-
-    auto div_result = gf_poly_div(padded_msg, gen);
-    std::vector<int> msg_out = msg_in;
-    msg_out.insert(msg_out.end(), div_result.second.begin(),
-                   div_result.second.end());
-    return msg_out;
+    return count;
 }
 
-std::vector<int> ReedSolomon::generator_poly() {
-    std::vector<int> g = {1};
-    for (int i = 0; i < CORRECTION_SYMBOL_COUNT; ++i) {
-        std::vector<int> term = {1, gf_exp_[i]};
-        g = gf_poly_mul(g, term);
-    }
-    return g;
-}
-
-std::vector<int> ReedSolomon::calc_syndromes(const std::vector<int>& msg) {
-    std::vector<int> synd(CORRECTION_SYMBOL_COUNT);
-    for (int i = 0; i < CORRECTION_SYMBOL_COUNT; ++i) {
-        synd[i] = gf_poly_eval(msg, gf_pow(2, i));
+void ReedSolomon::forney_syndromes(const uint8_t* synd, int nsym,
+                                   const uint8_t* erase_loc, int erase_count,
+                                   uint8_t* fsynd) {
+    for (int i = 0; i + erase_count < nsym; ++i) {
+        int t = 0;
+        for (int j = 0; j <= erase_count; ++j) {
+            t ^= gf256::mul(erase_loc[j], synd[i + erase_count - j]);
+        }
+        fsynd[i] = static_cast<uint8_t>(t);
     }
-    synd.insert(synd.begin(), 0);
-    return synd;
 }
 
-std::vector<int> ReedSolomon::find_errors_locator(
-    const std::vector<int>& e_pos) {
-    std::vector<int> e_loc = {1};
-    for (int i : e_pos) {
-        std::vector<int> term = {gf_pow(2, i), 0};
-        std::vector<int> sum = gf_poly_add({1}, term);
-        e_loc = gf_poly_mul(e_loc, sum);
+// Берлекэмп — Мэсси
+int ReedSolomon::find_error_locator(const uint8_t* synd, int count,
+                                    uint8_t* err_loc) {
+    uint8_t prev[SCRATCH_SIZE] = {1};
+    uint8_t tmp[SCRATCH_SIZE];
+    std::memset(err_loc, 0, SCRATCH_SIZE);
+    err_loc[0] = 1;
+    int len = 0;
+    int shift = 1;
+    int prev_delta = 1;
+
+    for (int k = 0; k < count; ++k) {
+        int delta = synd[k];
+        for (int i = 1; i <= len; ++i) {
+            delta ^= gf256::mul(err_loc[i], synd[k - i]);
+        }
+        if (delta == 0) {
+            ++shift;
+            continue;
+        }
+        int coef = gf256::div(delta, prev_delta);
+        bool grow = 2 * len <= k;
+        if (grow) std::memcpy(tmp, err_loc, SCRATCH_SIZE);
+        for (int i = 0; i + shift < SCRATCH_SIZE; ++i) {
+            err_loc[i + shift] ^= gf256::mul(coef, prev[i]);
+        }
+        if (grow) {
+            len = k + 1 - len;
+            std::memcpy(prev, tmp, SCRATCH_SIZE);
+            prev_delta = delta;
+            shift = 1;
+        } else {
+            ++shift;
+        }
     }
-    return e_loc;
+    return len;
 }
 
-std::vector<int> ReedSolomon::find_error_evaluator(
-    const std::vector<int>& synd, const std::vector<int>& err_loc, int nsym) {
-    auto product = gf_poly_mul(synd, err_loc);
-    std::vector<int> divisor(nsym + 2, 0);
-    divisor[0] = 1;
-    auto div_result = gf_poly_div(product, divisor);
-    return div_result.second;
-}
-
-std::vector<int> ReedSolomon::find_error_locator(
-    const std::vector<int>& synd, int erase_count) {
-    std::vector<int> err_loc = {1};
-    std::vector<int> old_loc = {1};
-
-    int synd_shift = synd.size() - CORRECTION_SYMBOL_COUNT;
-
-    for (int i = 0; i < CORRECTION_SYMBOL_COUNT - erase_count; ++i) {
-        int K = i + synd_shift;
-
-        int delta = synd[K];
-        for (size_t j = 1; j < err_loc.size(); ++j) {
-            delta ^= gf_mul(err_loc[err_loc.size() - 1 - j], synd[K - j]);
+// Поиск Ченя: корни локатора X^-1 дают позиции ошибок
+int ReedSolomon::find_errors(const uint8_t* loc, int degree, size_t n,
+                             int* pos) {
+    uint8_t term[SCRATCH_SIZE];
+    std::memcpy(term, loc, degree + 1);
+    int found = 0;
+    for (size_t e = 0; e < n; ++e) {
+        int sum = 0;
+        for (int i = 0; i <= degree; ++i) sum ^= term[i];
+        if (sum == 0) {
+            if (found == degree) return -1;
+            pos[found++] = static_cast<int>(n - 1 - e);
         }
-
-        old_loc.push_back(0);
-
-        if (delta != 0) {
-            if (old_loc.size() > err_loc.size()) {
-                auto new_loc = gf_poly_scale(old_loc, delta);
-                old_loc = gf_poly_scale(err_loc, gf_inverse(delta));
-                err_loc = new_loc;
-            }
-            err_loc = gf_poly_add(err_loc, gf_poly_scale(old_loc, delta));
+        for (int i = 1; i <= degree; ++i) {
+            term[i] = static_cast<uint8_t>(gf256::mul(term[i], gf256::exp(255 - i)));
         }
     }
-
-    while (!err_loc.empty() && err_loc[0] == 0) {
-        err_loc.erase(err_loc.begin());
-    }
-    int errs = err_loc.size() - 1;
-    if ((errs - erase_count) * 2 + erase_count > CORRECTION_SYMBOL_COUNT) {
-        throw std::runtime_error("Too many errors to correct");
-    }
-    return err_loc;
+    return found;
 }
 
-std::vector<int> ReedSolomon::find_errors(const std::vector<int>& err_loc,
-                                             int nmess) {
-    int errs = err_loc.size() - 1;
-    std::vector<int> err_pos;
-    for (int i = 0; i < nmess; ++i) {
-        if (gf_poly_eval(err_loc, gf_pow(2, i)) == 0) {
-            err_pos.push_back(nmess - 1 - i);
+// Алгоритм Форни: величины ошибок по локатору и оценщику
+bool ReedSolomon::correct_errata(uint8_t* msg, size_t n, const uint8_t* synd,
+                                 int nsym, const uint8_t* loc, int degree,
+                                 const int* pos, int count) {
+    uint8_t eval[SCRATCH_SIZE] = {0};
+    for (int i = 0; i < nsym; ++i) {
+        int t = 0;
+        for (int j = 0; j <= degree && j <= i; ++j) {
+            t ^= gf256::mul(loc[j], synd[i - j]);
         }
+        eval[i] = static_cast<uint8_t>(t);
     }
-    if (err_pos.size() != errs) {
-        throw std::runtime_error("Could not find error locations");
-    }
-    return err_pos;
-}
 
-std::vector<int> ReedSolomon::forney_syndromes(const std::vector<int>& synd,
-                                                  const std::vector<int>& pos,
-                                                  int nmess) {
-    std::vector<int> erase_pos_reversed(pos.size());
-    for (size_t i = 0; i < pos.size(); ++i) {
-        erase_pos_reversed[i] = nmess - 1 - pos[i];
-    }
-    std::vector<int> fsynd(synd.begin() + 1, synd.end());
-    for (size_t i = 0; i < pos.size(); ++i) {
-        int x = gf_pow(2, erase_pos_reversed[i]);
-        for (size_t j = 0; j < fsynd.size(); ++j) {
-            int next = (j + 1 < fsynd.size()) ? fsynd[j + 1] : 0;
-            fsynd[j] = gf_mul(fsynd[j], x) ^ next;
+    for (int k = 0; k < count; ++k) {
+        int e = static_cast<int>(n - 1 - pos[k]);
+        int x_inv = gf256::exp((255 - e) % 255);
+
+        int num = 0;
+        for (int i = nsym - 1; i >= 0; --i) {
+            num = gf256::mul(num, x_inv) ^ eval[i];
+        }
+        int den = 0;
+        for (int i = degree - (degree % 2 == 0 ? 1 : 0); i >= 1; i -= 2) {
+            den = gf256::mul(den, gf256::mul(x_inv, x_inv)) ^ loc[i];
         }
+        if (den == 0) return false;
+        msg[pos[k]] ^= gf256::mul(gf256::exp(e), gf256::div(num, den));
     }
-    return fsynd;
+    return true;
 }
 
-std::vector<int> ReedSolomon::correct_errata(
-    std::vector<int> msg_in, const std::vector<int>& synd,
-    const std::vector<int>& err_pos) {
-    std::vector<int> coef_pos(err_pos.size());
-    int len_msg = msg_in.size();
-    for (size_t i = 0; i < err_pos.size(); ++i) {
-        coef_pos[i] = len_msg - 1 - err_pos[i];
+ReedSolomon::DecodeResult ReedSolomon::decode_block(uint8_t* msg, size_t n,
+                                                    int nsym,
+                                                    const int* erase_pos,
+                                                    int erase_count) const {
+    DecodeResult result;
+    result.erasures = erase_count;
+    if (n > 255 || nsym < 1 || nsym > MAX_ECC_LENGTH ||
+        static_cast<size_t>(nsym) >= n || erase_count > nsym) {
+        return result;
+    }
+    for (int k = 0; k < erase_count; ++k) {
+        if (erase_pos[k] < 0 || static_cast<size_t>(erase_pos[k]) >= n) {
+            return result;
+        }
+        msg[erase_pos[k]] = 0;
     }
 
-    std::vector<int> err_loc = find_errors_locator(coef_pos);
-    std::vector<int> synd_rev(synd.rbegin(), synd.rend());
-    std::vector<int> err_eval =
-        find_error_evaluator(synd_rev, err_loc, err_loc.size() - 1);
-    std::reverse(err_eval.begin(), err_eval.end());
-
-    std::vector<int> X(coef_pos.size());
-    for (size_t i = 0; i < coef_pos.size(); ++i) {
-        int l = 255 - coef_pos[i];
-        X[i] = gf_pow(2, -l);
+    uint8_t synd[SCRATCH_SIZE];
+    if (!calc_syndromes(msg, n, nsym, synd)) {
+        result.ok = true;
+        return result;
     }
 
-    std::vector<int> E(len_msg, 0);
-    for (size_t i = 0; i < X.size(); ++i) {
-        int Xi = X[i];
-        int Xi_inv = gf_inverse(Xi);
-
-        std::vector<int> err_loc_prime_tmp;
-        for (size_t j = 0; j < X.size(); ++j) {
-            if (j != i) {
-                err_loc_prime_tmp.push_back(1 ^ gf_mul(Xi_inv, X[j]));
-            }
-        }
-        int err_loc_prime = 1;
-        for (int coef : err_loc_prime_tmp) {
-            err_loc_prime = gf_mul(err_loc_prime, coef);
-        }
-
-        int y = gf_poly_eval(err_eval, Xi_inv);
-        y = gf_mul(gf_pow(Xi, 1), y);
+    uint8_t erase_loc[SCRATCH_SIZE];
+    uint8_t fsynd[SCRATCH_SIZE];
+    uint8_t err_loc[SCRATCH_SIZE];
+    find_errors_locator(erase_pos, erase_count, n, erase_loc);
+    forney_syndromes(synd, nsym, erase_loc, erase_count, fsynd);
+    int errs = find_error_locator(fsynd, nsym - erase_count, err_loc);
+    if (2 * errs + erase_count > nsym) return result;
 
-        if (err_loc_prime == 0) {
-            throw std::runtime_error("Cannot find error magnitude");
+    // Общий локатор стираний и ошибок
+    uint8_t loc[SCRATCH_SIZE] = {0};
+    int degree = errs + erase_count;
+    for (int i = 0; i <= errs; ++i) {
+        for (int j = 0; j <= erase_count; ++j) {
+            loc[i + j] ^= gf256::mul(err_loc[i], erase_loc[j]);
         }
+    }
 
-        int magnitude = gf_div(y, err_loc_prime);
-        E[err_pos[i]] = magnitude;
+    int pos[SCRATCH_SIZE];
+    if (find_errors(loc, degree, n, pos) != degree) return result;
+    if (!correct_errata(msg, n, synd, nsym, loc, degree, pos, degree)) {
+        return result;
     }
+    if (calc_syndromes(msg, n, nsym, synd)) return result;
 
-    msg_in = gf_poly_add(msg_in, E);
-    return msg_in;
+    result.ok = true;
+    result.errors = errs;
+    return result;
 }
 
-std::pair<std::vector<int>, std::vector<int>> ReedSolomon::decode_message(
-    std::vector<int> msg_in, const std::vector<int>& erase_pos) {
-    if (msg_in.size() > 255) {
-        throw std::runtime_error("Message too long");
-    }
-
-    std::vector<int> msg_out = msg_in;
-    if (!erase_pos.empty()) {
-        for (int e_pos : erase_pos) {
-            msg_out[e_pos] = 0;
+std::string ReedSolomon::decode(Code code, EccLevel level,
+                                std::vector<int> erase_pos,
+                                DecodeResult* stats,
+                                qr_segment::AppendHeader* append) {
+    instrument::ScopedStage stage(instrument::Stage::RS_DECODE);
+    int version = qr_spec::version_for_codewords(static_cast<int>(code.size()));
+    if (version == 0) {
+        throw std::runtime_error("Invalid codeword count");
+    }
+    qr_spec::BlockLayout layout = qr_spec::block_layout(version, level);
+
+    // Блоки исправляются по отдельности, стирания переводятся в индексы
+    // внутри блока
+    Code data(layout.data_codewords);
+    DecodeResult result;
+    result.ok = true;
+    uint8_t block[256];
+    int block_erasures[MAX_ECC_LENGTH + 1];
+    for (int b = 0; b < layout.blocks && result.ok; ++b) {
+        int length = layout.data_length(b);
+        for (int i = 0; i < length; ++i) {
+            block[i] = code[layout.data_position(b, i)];
         }
-    }
-
-    if (erase_pos.size() > static_cast<size_t>(CORRECTION_SYMBOL_COUNT)) {
-        throw std::runtime_error("Too many erasures to correct");
-    }
-
-    std::vector<int> synd = calc_syndromes(msg_out);
-    if (*std::max_element(synd.begin(), synd.end()) == 0) {
-        std::vector<int> data(msg_out.begin(),
-                              msg_out.end() - CORRECTION_SYMBOL_COUNT);
-        std::vector<int> ecc(msg_out.end() - CORRECTION_SYMBOL_COUNT,
-                             msg_out.end());
-        return {data, ecc};
-    }
+        for (int j = 0; j < layout.ecc; ++j) {
+            block[length + j] = code[layout.ecc_position(b, j)];
+        }
+        int erase_count = 0;
+        for (int pos : erase_pos) {
+            int owner = 0;
+            int index = 0;
+            if (pos < 0 || pos >= layout.total_codewords) {
+                throw std::runtime_error("Erasure position out of range");
+            }
+            layout.locate(pos, owner, index);
+            if (owner != b) continue;
+            if (erase_count == layout.ecc) {
+                result.ok = false;
+                break;
+            }
+            block_erasures[erase_count++] = index;
+        }
+        if (!result.ok) break;
 
-    std::vector<int> fsynd =
-        forney_syndromes(synd, erase_pos, msg_out.size());
-    std::vector<int> err_loc = find_error_locator(fsynd, erase_pos.size());
-    std::vector<int> err_loc_rev(err_loc.rbegin(), err_loc.rend());
-    std::vector<int> err_pos = find_errors(err_loc_rev, msg_out.size());
-    if (err_pos.empty()) {
-        throw std::runtime_error("Could not locate errors");
+        DecodeResult r = decode_block(block, length + layout.ecc, layout.ecc,
+                                      block_erasures, erase_count);
+        result.ok = r.ok;
+        result.errors += r.errors;
+        result.erasures += r.erasures;
+        std::copy(block, block + length, data.begin() + layout.data_offset(b));
     }
-
-    msg_out = correct_errata(msg_out, synd, erase_pos);
-
-    synd = calc_syndromes(msg_out);
-    if (*std::max_element(synd.begin(), synd.end()) > 0) {
+    if (stats) *stats = result;
+    if (!result.ok) {
         throw std::runtime_error("Could not correct message");
     }
 
-    std::vector<int> data(msg_out.begin(),
-                          msg_out.end() - CORRECTION_SYMBOL_COUNT);
-    std::vector<int> ecc(msg_out.end() - CORRECTION_SYMBOL_COUNT,
-                         msg_out.end());
-    return {data, ecc};
+    return qr_segment::parse(data.data(), data.size(), version, append);
 }
-
-std::string ReedSolomon::decode(Code code, std::vector<int> erase_pos) {
-
-};
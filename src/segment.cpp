@@ -0,0 +1,170 @@
+#include "segment.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace qr_segment {
+
+uint8_t classify(const uint8_t* data, size_t n, uint8_t* classes) {
+    size_t i = 0;
+    uint8_t all = CLASS_NUMERIC | CLASS_ALPHANUMERIC;
+#if defined(__SSE2__)
+    // Знаковые сравнения: байты от 0x80 отрицательны и не попадают в
+    // диапазоны, а '-', '.', '/' идут подряд
+    const __m128i one = _mm_set1_epi8(CLASS_NUMERIC);
+    const __m128i two = _mm_set1_epi8(CLASS_ALPHANUMERIC);
+    __m128i acc = _mm_set1_epi8(-1);
+    auto in_range = [](__m128i v, char lo, char hi) {
+        return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)),
+                             _mm_cmplt_epi8(v, _mm_set1_epi8(hi + 1)));
+    };
+    for (; i + 16 <= n; i += 16) {
+        __m128i v =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i digit = in_range(v, '0', '9');
+        __m128i alnum = _mm_or_si128(digit, in_range(v, 'A', 'Z'));
+        alnum = _mm_or_si128(alnum, in_range(v, '-', '/'));
+        alnum = _mm_or_si128(alnum, in_range(v, '$', '%'));
+        alnum = _mm_or_si128(alnum, in_range(v, '*', '+'));
+        alnum = _mm_or_si128(alnum, _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+        alnum = _mm_or_si128(alnum, _mm_cmpeq_epi8(v, _mm_set1_epi8(':')));
+        __m128i cls = _mm_or_si128(_mm_and_si128(digit, one),
+                                   _mm_and_si128(alnum, two));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(classes + i), cls);
+        acc = _mm_and_si128(acc, cls);
+    }
+    alignas(16) uint8_t lanes[16];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    for (uint8_t lane : lanes) all &= lane;
+#endif
+    for (; i < n; ++i) {
+        classes[i] = CHARS.cls[data[i]];
+        all &= classes[i];
+    }
+    return all;
+}
+
+size_t plan(const uint8_t* classes, size_t n, int version,
+            std::vector<Segment>& out) {
+    std::vector<uint8_t> from(n * 3);
+    out.resize(std::max<size_t>(n, 1));
+    out.resize(plan_segments(classes, n, version, from.data(), out.data()));
+    return segments_bits(out.data(), out.size(), version);
+}
+
+int choose_version(const uint8_t* data, size_t n, qr_spec::EccLevel level,
+                   std::vector<Segment>& segments, size_t reserved_bits) {
+    std::vector<uint8_t> classes(n);
+    bool numeric = n > 0 && (classify(data, n, classes.data()) & CLASS_NUMERIC);
+    return smallest_version(level, reserved_bits, [&](int last) {
+        if (numeric) {
+            // Одни цифры: один числовой сегмент оптимален
+            segments.assign(1, Segment{Mode::NUMERIC, 0, n});
+            return segment_bits(Mode::NUMERIC, n, last);
+        }
+        return plan(classes.data(), n, last, segments);
+    });
+}
+
+uint8_t append_parity(const uint8_t* data, size_t n) {
+    uint8_t parity = 0;
+    for (size_t i = 0; i < n; ++i) parity ^= data[i];
+    return parity;
+}
+
+void write_append_header(BitWriter& writer, const AppendHeader& header) {
+    writer.append(APPEND_MODE, 4);
+    writer.append(static_cast<uint32_t>(header.index), 4);
+    writer.append(static_cast<uint32_t>(header.total - 1), 4);
+    writer.append(header.parity, 8);
+}
+
+void write(BitWriter& writer, const uint8_t* data,
+           const std::vector<Segment>& segments, int version) {
+    write_segments(writer, data, segments.data(), segments.size(), version);
+}
+
+std::string parse(const uint8_t* data, size_t n, int version,
+                  AppendHeader* append) {
+    size_t bit = 0;
+    size_t total = n * 8;
+    auto read_bits = [&](int count) {
+        if (bit + count > total) {
+            throw std::runtime_error("Segment length exceeds data capacity");
+        }
+        uint32_t value = 0;
+        for (int i = 0; i < count; ++i, ++bit) {
+            value = (value << 1) | ((data[bit / 8] >> (7 - bit % 8)) & 1);
+        }
+        return value;
+    };
+
+    std::string message;
+    while (bit + 4 <= total) {
+        uint32_t indicator = read_bits(4);
+        if (indicator == 0) break;  // терминатор
+        if (indicator == APPEND_MODE) {
+            AppendHeader header;
+            header.index = static_cast<int>(read_bits(4));
+            header.total = static_cast<int>(read_bits(4)) + 1;
+            header.parity = static_cast<uint8_t>(read_bits(8));
+            if (append) *append = header;
+            continue;
+        }
+        if (indicator != 0x1 && indicator != 0x2 && indicator != 0x4) {
+            throw std::runtime_error("Unsupported segment mode");
+        }
+        Mode mode = static_cast<Mode>(indicator);
+        size_t length = read_bits(qr_spec::count_bits(mode, version));
+        size_t i = 0;
+        switch (mode) {
+            case Mode::NUMERIC:
+                for (; i < length; i += 3) {
+                    int digits =
+                        static_cast<int>(std::min<size_t>(3, length - i));
+                    uint32_t value = read_bits(digits * 3 + 1);
+                    char buf[3];
+                    for (int d = digits - 1; d >= 0; --d, value /= 10) {
+                        buf[d] = static_cast<char>('0' + value % 10);
+                    }
+                    if (value != 0) {
+                        throw std::runtime_error("Invalid numeric segment");
+                    }
+                    message.append(buf, digits);
+                }
+                break;
+            case Mode::ALPHANUMERIC:
+                for (; i + 2 <= length; i += 2) {
+                    uint32_t value = read_bits(11);
+                    if (value >= 45 * 45) {
+                        throw std::runtime_error(
+                            "Invalid alphanumeric segment");
+                    }
+                    message += ALPHANUMERIC_CHARS[value / 45];
+                    message += ALPHANUMERIC_CHARS[value % 45];
+                }
+                if (i < length) {
+                    uint32_t value = read_bits(6);
+                    if (value >= 45) {
+                        throw std::runtime_error(
+                            "Invalid alphanumeric segment");
+                    }
+                    message += ALPHANUMERIC_CHARS[value];
+                }
+                break;
+            case Mode::BYTE:
+                for (; i < length; ++i) {
+                    message += static_cast<char>(read_bits(8));
+                }
+                break;
+        }
+    }
+    return message;
+}
+
+}  // namespace qr_segment
@@ -0,0 +1,548 @@
+#include "server.h"
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.h"
+#include "image_writer.h"
+#include "qr_code.h"
+#include "reed_solomon.h"
+#include "symbol_cache.h"
+
+namespace server {
+
+namespace {
+
+constexpr size_t READ_CHUNK = 64 * 1024;
+constexpr size_t FRAME_HEADER_SIZE = 4 + RESPONSE_HEADER_SIZE;
+#ifdef IOV_MAX
+constexpr size_t IOV_LIMIT = IOV_MAX;
+#else
+constexpr size_t IOV_LIMIT = 1024;
+#endif
+
+std::atomic<bool> stop_requested{false};
+
+void on_signal(int) { stop_requested.store(true); }
+
+uint32_t load_be32(const uint8_t* p) {
+    return uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 |
+           uint32_t(p[3]);
+}
+
+void store_be32(uint8_t* p, uint32_t value) {
+    p[0] = value >> 24;
+    p[1] = value >> 16;
+    p[2] = value >> 8;
+    p[3] = value;
+}
+
+struct Connection {
+    explicit Connection(int fd) : fd(fd) {}
+    ~Connection() { ::close(fd); }
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    int fd;
+    std::mutex write_mutex;
+    bool broken = false;  // под write_mutex
+};
+
+struct Request {
+    uint32_t id;
+    uint8_t level;
+    uint8_t format;
+    uint8_t scale;
+    uint8_t quiet;
+    size_t offset;  // данные в буфере пакета
+    size_t length;
+};
+
+// Кадры одного чтения. Буфер чтения передаётся пакету целиком, данные
+// запросов не копируются.
+struct Batch {
+    std::shared_ptr<Connection> connection;
+    std::shared_ptr<const std::vector<uint8_t>> data;
+    std::vector<Request> requests;
+};
+
+struct Shared {
+    explicit Shared(size_t capacity) : queue(capacity) {}
+
+    BoundedQueue<Batch> queue;
+    std::unique_ptr<SymbolCache> cache;
+    size_t max_batch = 64;
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> failed{0};
+    std::atomic<uint64_t> batches{0};
+
+    std::mutex mutex;
+    std::vector<std::weak_ptr<Connection>> connections;
+    // Читатели, закончившие работу; run_server присоединяет их потоки
+    std::vector<std::thread::id> finished_readers;
+};
+
+// Присоединяет завершившиеся потоки читателей (или все при all)
+void join_readers(Shared& shared, std::vector<std::thread>& readers,
+                  bool all) {
+    std::vector<std::thread::id> finished;
+    {
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        finished.swap(shared.finished_readers);
+    }
+    for (auto it = readers.begin(); it != readers.end();) {
+        if (all || std::find(finished.begin(), finished.end(), it->get_id()) !=
+                       finished.end()) {
+            it->join();
+            it = readers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void fill_header(uint8_t* header, size_t body_size, uint32_t id,
+                 Status status, int version, int mask, int format) {
+    store_be32(header, static_cast<uint32_t>(RESPONSE_HEADER_SIZE + body_size));
+    store_be32(header + 4, id);
+    header[8] = status;
+    header[9] = static_cast<uint8_t>(version);
+    header[10] = static_cast<uint8_t>(mask);
+    header[11] = static_cast<uint8_t>(format);
+}
+
+// Отправляет кадры целиком, продолжая после частичной записи. При ошибке
+// соединение помечается сломанным и закрывается в обе стороны.
+bool send_frames(Connection& connection, iovec* iov, size_t count) {
+    std::lock_guard<std::mutex> lock(connection.write_mutex);
+    if (connection.broken) return false;
+    while (count > 0) {
+        msghdr message = {};
+        message.msg_iov = iov;
+        message.msg_iovlen = std::min(count, IOV_LIMIT);
+        ssize_t n = ::sendmsg(connection.fd, &message, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            connection.broken = true;
+            ::shutdown(connection.fd, SHUT_RDWR);
+            return false;
+        }
+        size_t sent = static_cast<size_t>(n);
+        while (count > 0 && sent >= iov->iov_len) {
+            sent -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<uint8_t*>(iov->iov_base) + sent;
+            iov->iov_len -= sent;
+        }
+    }
+    return true;
+}
+
+// Состояние рабочего потока; буферы переиспользуются между пакетами
+class Worker {
+   public:
+    explicit Worker(Shared& shared) : shared_(shared) {}
+
+    void run() {
+        Batch batch;
+        while (shared_.queue.pop(batch)) {
+            process(batch);
+            batch = Batch();  // буфер чтения и соединение освобождаются
+        }
+    }
+
+   private:
+    struct Reply {
+        uint8_t header[FRAME_HEADER_SIZE];
+        const uint8_t* body;
+        size_t body_size;
+    };
+
+    void process(const Batch& batch) {
+        size_t n = batch.requests.size();
+        if (replies_.size() < n) {
+            replies_.resize(n);
+            images_.resize(n);
+            symbols_.resize(n);
+            errors_.resize(n);
+        }
+        uint64_t failed = 0;
+        for (size_t i = 0; i < n; ++i) {
+            if (!encode(batch, i)) ++failed;
+        }
+
+        iov_.clear();
+        for (size_t i = 0; i < n; ++i) {
+            Reply& reply = replies_[i];
+            iov_.push_back({reply.header, FRAME_HEADER_SIZE});
+            if (reply.body_size > 0) {
+                iov_.push_back(
+                    {const_cast<uint8_t*>(reply.body), reply.body_size});
+            }
+        }
+        send_frames(*batch.connection, iov_.data(), iov_.size());
+
+        for (size_t i = 0; i < n; ++i) symbols_[i].reset();
+        shared_.requests += n;
+        shared_.failed += failed;
+        ++shared_.batches;
+    }
+
+    // Ответ на запрос i; тело ссылается на буфер рендера, запись кэша или
+    // текст ошибки и живёт до отправки пакета
+    bool encode(const Batch& batch, size_t i) {
+        const Request& request = batch.requests[i];
+        Reply& reply = replies_[i];
+        Status status = OK;
+        int version = 0;
+        int mask = 0;
+        try {
+            if (request.level > 3 || request.format > 2 ||
+                request.scale == 0) {
+                throw std::invalid_argument("Invalid request fields");
+            }
+            SymbolKey key;
+            key.payload = std::string_view(
+                reinterpret_cast<const char*>(batch.data->data()) +
+                    request.offset,
+                request.length);
+            key.level = static_cast<qr_spec::EccLevel>(request.level);
+            key.with_image = true;
+            key.render.scale = request.scale;
+            key.render.quiet_zone = request.quiet;
+            key.render.format = static_cast<ImageFormat>(request.format);
+
+            std::shared_ptr<const CachedSymbol> symbol;
+            if (shared_.cache) symbol = shared_.cache->find(key);
+            if (symbol) {
+                version = (symbol->size - 17) / 4;
+                mask = symbol->mask;
+                reply.body = symbol->image.data();
+                reply.body_size = symbol->image.size();
+                symbols_[i] = std::move(symbol);
+            } else {
+                message_.assign(key.payload);
+                ReedSolomon::Code code = solomon_.encode(message_, key.level);
+                mask = qr_.generate(code.data(), code.size(), matrix_,
+                                    key.level);
+                version = (matrix_.size() - 17) / 4;
+                int side = (matrix_.size() + 2 * request.quiet) *
+                           request.scale;
+                if (side > MAX_IMAGE_SIDE &&
+                    key.render.format != ImageFormat::SVG) {
+                    throw std::length_error("Image too large");
+                }
+                std::vector<uint8_t>& image = images_[i];
+                render_image(matrix_, key.render, image);
+                if (shared_.cache) {
+                    // Буфер переходит в запись кэша без копирования, ответ
+                    // уходит из неё, как при попадании
+                    symbols_[i] = shared_.cache->insert(key, matrix_, mask,
+                                                        std::move(image));
+                    image.clear();
+                    reply.body = symbols_[i]->image.data();
+                    reply.body_size = symbols_[i]->image.size();
+                } else {
+                    reply.body = image.data();
+                    reply.body_size = image.size();
+                }
+            }
+        } catch (const std::invalid_argument& e) {
+            status = BAD_REQUEST;
+            errors_[i] = e.what();
+        } catch (const std::exception& e) {
+            status = ENCODE_FAILED;
+            errors_[i] = e.what();
+        }
+        if (status != OK) {
+            version = 0;
+            mask = 0;
+            reply.body = reinterpret_cast<const uint8_t*>(errors_[i].data());
+            reply.body_size = errors_[i].size();
+        }
+        fill_header(reply.header, reply.body_size, request.id, status,
+                    version, mask, request.format);
+        return status == OK;
+    }
+
+    Shared& shared_;
+    ReedSolomon solomon_;
+    QRCode qr_;
+    QRMatrix matrix_;
+    std::string message_;
+    std::vector<Reply> replies_;
+    std::vector<std::vector<uint8_t>> images_;
+    std::vector<std::shared_ptr<const CachedSymbol>> symbols_;
+    std::vector<std::string> errors_;
+    std::vector<iovec> iov_;
+};
+
+void reject_frame(Connection& connection, uint32_t id) {
+    static const char MESSAGE[] = "Frame too large";
+    uint8_t header[FRAME_HEADER_SIZE];
+    size_t size = sizeof(MESSAGE) - 1;
+    fill_header(header, size, id, BAD_REQUEST, 0, 0, 0);
+    iovec iov[2] = {{header, FRAME_HEADER_SIZE},
+                    {const_cast<char*>(MESSAGE), size}};
+    send_frames(connection, iov, 2);
+}
+
+// Читает кадры соединения и отдаёт их рабочим пакетами до max_batch
+// запросов. Остаток неполного кадра переносится в новый буфер.
+void read_connection(Shared& shared,
+                     const std::shared_ptr<Connection>& connection) {
+    auto buffer = std::make_shared<std::vector<uint8_t>>(READ_CHUNK);
+    size_t used = 0;
+    for (;;) {
+        if (buffer->size() - used < READ_CHUNK / 2) {
+            buffer->resize(used + READ_CHUNK);
+        }
+        ssize_t n = ::recv(connection->fd, buffer->data() + used,
+                           buffer->size() - used, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        used += static_cast<size_t>(n);
+
+        const uint8_t* data = buffer->data();
+        size_t pos = 0;
+        bool any = false;
+        bool reject = false;
+        Batch batch;
+        while (used - pos >= 4) {
+            size_t length = load_be32(data + pos);
+            if (length < REQUEST_HEADER_SIZE ||
+                length > REQUEST_HEADER_SIZE + MAX_PAYLOAD) {
+                reject = true;
+                break;
+            }
+            if (used - pos - 4 < length) break;
+            const uint8_t* frame = data + pos + 4;
+            Request request;
+            request.id = load_be32(frame);
+            request.level = frame[4];
+            request.format = frame[5];
+            request.scale = frame[6];
+            request.quiet = frame[7];
+            request.offset = pos + 4 + REQUEST_HEADER_SIZE;
+            request.length = length - REQUEST_HEADER_SIZE;
+            batch.requests.push_back(request);
+            pos += 4 + length;
+            if (batch.requests.size() == shared.max_batch) {
+                batch.connection = connection;
+                batch.data = buffer;
+                shared.queue.push(std::move(batch));
+                batch = Batch();
+                any = true;
+            }
+        }
+        if (!batch.requests.empty()) {
+            batch.connection = connection;
+            batch.data = buffer;
+            shared.queue.push(std::move(batch));
+            any = true;
+        }
+        if (reject) {
+            uint32_t id = used - pos >= 8 ? load_be32(data + pos + 4) : 0;
+            reject_frame(*connection, id);
+            return;
+        }
+        if (any) {
+            auto next = std::make_shared<std::vector<uint8_t>>(
+                std::max(READ_CHUNK, used - pos));
+            std::memcpy(next->data(), data + pos, used - pos);
+            buffer = std::move(next);
+        } else if (pos > 0) {
+            std::memmove(buffer->data(), data + pos, used - pos);
+        }
+        used -= pos;
+    }
+}
+
+struct Listener {
+    int fd = -1;
+    bool tcp = false;
+    std::string path;  // для Unix-сокета, удаляется при остановке
+
+    ~Listener() {
+        if (fd >= 0) ::close(fd);
+        if (!path.empty()) ::unlink(path.c_str());
+    }
+};
+
+void open_listener(const std::string& address, Listener& listener) {
+    const std::string tcp_prefix = "tcp:";
+    const std::string unix_prefix = "unix:";
+    int result;
+    if (address.compare(0, tcp_prefix.size(), tcp_prefix) == 0) {
+        int port = std::stoi(address.substr(tcp_prefix.size()));
+        if (port <= 0 || port > 65535) {
+            throw std::runtime_error("Invalid port in " + address);
+        }
+        listener.tcp = true;
+        listener.fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listener.fd < 0) {
+            throw std::runtime_error("Cannot create socket: " +
+                                     std::string(std::strerror(errno)));
+        }
+        int one = 1;
+        ::setsockopt(listener.fd, SOL_SOCKET, SO_REUSEADDR, &one,
+                     sizeof(one));
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        result = ::bind(listener.fd, reinterpret_cast<sockaddr*>(&addr),
+                        sizeof(addr));
+    } else {
+        std::string path = address;
+        if (path.compare(0, unix_prefix.size(), unix_prefix) == 0) {
+            path = path.substr(unix_prefix.size());
+        }
+        sockaddr_un addr = {};
+        if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+            throw std::runtime_error("Invalid socket path " + path);
+        }
+        listener.fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listener.fd < 0) {
+            throw std::runtime_error("Cannot create socket: " +
+                                     std::string(std::strerror(errno)));
+        }
+        // Сокет, оставшийся от прошлого запуска, удаляется; другие файлы нет
+        struct stat st;
+        if (::stat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+            ::unlink(path.c_str());
+        }
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, path.c_str(), path.size());
+        result = ::bind(listener.fd, reinterpret_cast<sockaddr*>(&addr),
+                        sizeof(addr));
+        if (result == 0) listener.path = path;
+    }
+    if (result != 0 || ::listen(listener.fd, SOMAXCONN) != 0) {
+        throw std::runtime_error("Cannot listen on " + address + ": " +
+                                 std::strerror(errno));
+    }
+}
+
+// Обработчики SIGINT/SIGTERM на время работы сервера
+class SignalScope {
+   public:
+    SignalScope() {
+        stop_requested.store(false);
+        struct sigaction action = {};
+        action.sa_handler = on_signal;
+        sigemptyset(&action.sa_mask);
+        ::sigaction(SIGINT, &action, &old_int_);
+        ::sigaction(SIGTERM, &action, &old_term_);
+    }
+    ~SignalScope() {
+        ::sigaction(SIGINT, &old_int_, nullptr);
+        ::sigaction(SIGTERM, &old_term_, nullptr);
+    }
+
+   private:
+    struct sigaction old_int_;
+    struct sigaction old_term_;
+};
+
+}  // namespace
+
+ServerStats run_server(const ServerOptions& options) {
+    if (options.max_batch == 0) {
+        throw std::runtime_error("Batch size must be positive");
+    }
+    int threads = options.threads;
+    if (threads <= 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    Listener listener;
+    open_listener(options.address, listener);
+    SignalScope signals;
+
+    Shared shared(2 * threads);
+    shared.max_batch = options.max_batch;
+    if (options.cache_bytes > 0) {
+        shared.cache.reset(new SymbolCache(options.cache_bytes));
+    }
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&shared] { Worker(shared).run(); });
+    }
+
+    ServerStats stats;
+    std::vector<std::thread> readers;
+    while (!stop_requested.load()) {
+        join_readers(shared, readers, false);
+        pollfd poll_fd = {listener.fd, POLLIN, 0};
+        int ready = ::poll(&poll_fd, 1, 200);
+        if (ready <= 0) continue;  // тайм-аут или сигнал
+        int fd = ::accept(listener.fd, nullptr, nullptr);
+        if (fd < 0) continue;
+        if (listener.tcp) {
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+        auto connection = std::make_shared<Connection>(fd);
+        ++stats.connections;
+        {
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            auto& list = shared.connections;
+            list.erase(std::remove_if(list.begin(), list.end(),
+                                      [](const std::weak_ptr<Connection>& c) {
+                                          return c.expired();
+                                      }),
+                       list.end());
+            list.push_back(connection);
+        }
+        readers.emplace_back([&shared, connection] {
+            read_connection(shared, connection);
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            shared.finished_readers.push_back(std::this_thread::get_id());
+        });
+    }
+
+    // Новые запросы больше не читаются; принятые обрабатываются до конца.
+    // Все читатели присоединяются до разрушения shared.
+    {
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        for (const auto& weak : shared.connections) {
+            if (auto connection = weak.lock()) {
+                ::shutdown(connection->fd, SHUT_RD);
+            }
+        }
+    }
+    join_readers(shared, readers, true);
+    shared.queue.close();
+    for (auto& worker : workers) worker.join();
+
+    stats.requests = shared.requests;
+    stats.failed = shared.failed;
+    stats.batches = shared.batches;
+    return stats;
+}
+
+}  // namespace server
@@ -0,0 +1,120 @@
+#include "structured_append.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+
+#include "qr_code.h"
+#include "reed_solomon.h"
+
+namespace {
+
+// Части длиной chunk или chunk + 1 байт, более длинные идут первыми
+bool split_into(const std::string &message, size_t parts,
+                qr_spec::EccLevel level, int max_version,
+                std::vector<std::string> &out) {
+    out.clear();
+    size_t chunk = message.size() / parts;
+    size_t longer = message.size() % parts;
+    size_t offset = 0;
+    for (size_t i = 0; i < parts; ++i) {
+        size_t length = chunk + (i < longer ? 1 : 0);
+        out.push_back(message.substr(offset, length));
+        offset += length;
+        try {
+            if (ReedSolomon::choose_version(out.back(), level, nullptr,
+                                            true) > max_version) {
+                return false;
+            }
+        } catch (const std::runtime_error &) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+std::vector<std::string> split_message(const std::string &message,
+                                       qr_spec::EccLevel level,
+                                       int max_version) {
+    if (max_version < qr_spec::MIN_VERSION ||
+        max_version > qr_spec::MAX_VERSION) {
+        throw std::runtime_error("Invalid maximum version");
+    }
+    std::vector<std::string> parts;
+    size_t most = std::max<size_t>(
+        1, std::min<size_t>(qr_segment::MAX_APPEND_SYMBOLS, message.size()));
+    for (size_t count = 1; count <= most; ++count) {
+        if (split_into(message, count, level, max_version, parts)) {
+            return parts;
+        }
+    }
+    throw std::runtime_error("Message too long");
+}
+
+AppendStats write_append_files(const std::string &message,
+                               const std::string &filename,
+                               const AppendOptions &options) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::string> parts =
+        split_message(message, options.level, options.max_version);
+    qr_segment::AppendHeader header;
+    header.total = static_cast<int>(parts.size());
+    header.parity = qr_segment::append_parity(
+        reinterpret_cast<const uint8_t *>(message.data()), message.size());
+
+    int threads = options.threads;
+    if (threads <= 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::min(threads, header.total);
+
+    // Каждая часть — отдельная задача; первая ошибка останавливает
+    // оставшиеся и бросается после join
+    std::vector<int> versions(parts.size(), 0);
+    std::vector<size_t> sizes(parts.size(), 0);
+    std::atomic<size_t> next{0};
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+    auto body = [&] {
+        ReedSolomon solomon;
+        QRCode qr;
+        QRMatrix matrix;
+        std::vector<uint8_t> image;
+        try {
+            for (size_t i = next++; i < parts.size() && !failed; i = next++) {
+                qr_segment::AppendHeader part = header;
+                part.index = static_cast<int>(i);
+                ReedSolomon::Code code =
+                    solomon.encode(parts[i], options.level, part);
+                qr.generate(code.data(), code.size(), matrix, options.level);
+                save_image(matrix, numbered_filename(filename, i, 2),
+                           options.render, image);
+                versions[i] = (matrix.size() - 17) / 4;
+                sizes[i] = image.size();
+            }
+        } catch (...) {
+            if (!failed.exchange(true)) error = std::current_exception();
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; ++t) workers.emplace_back(body);
+    body();
+    for (auto &worker : workers) worker.join();
+    if (error) std::rethrow_exception(error);
+
+    AppendStats stats;
+    stats.parts = parts.size();
+    for (size_t i = 0; i < parts.size(); ++i) {
+        stats.max_version = std::max(stats.max_version, versions[i]);
+        stats.bytes += sizes[i];
+    }
+    stats.seconds = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+    return stats;
+}
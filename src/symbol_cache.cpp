@@ -0,0 +1,164 @@
+#include "symbol_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+// Примерные накладные расходы записи: узел списка, элемент индекса,
+// блок shared_ptr
+constexpr size_t NODE_OVERHEAD = 160;
+
+uint64_t mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+// Хэш по 8 байтов за шаг
+uint64_t hash_bytes(const char* data, size_t n, uint64_t seed) {
+    uint64_t h = seed ^ (n * 0x9e3779b97f4a7c15ull);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        h = mix(h ^ word) * 0x9e3779b97f4a7c15ull;
+    }
+    // Пустой хвост не копируется: data может быть nullptr
+    uint64_t tail = 0;
+    if (i < n) std::memcpy(&tail, data + i, n - i);
+    return mix(h ^ tail);
+}
+
+}  // namespace
+
+void CachedSymbol::copy_to(QRMatrix& out) const {
+    out.reset(size);
+    std::copy(words.begin(), words.end(), out.data());
+}
+
+SymbolCache::SymbolCache(size_t memory_budget, int shards) {
+    if (shards < 1) throw std::runtime_error("Cache needs at least one shard");
+    shard_budget_ = memory_budget / shards;
+    for (int i = 0; i < shards; ++i) shards_.emplace_back(new Shard);
+}
+
+uint64_t SymbolCache::pack_params(const SymbolKey& key) {
+    uint64_t params = static_cast<uint64_t>(key.level) |
+                      static_cast<uint64_t>(key.mask + 1) << 2 |
+                      static_cast<uint64_t>(key.with_image) << 6;
+    if (key.with_image) {
+        params |= static_cast<uint64_t>(key.render.format) << 7 |
+                  static_cast<uint64_t>(key.render.scale & 0x7FFFFF) << 9 |
+                  static_cast<uint64_t>(key.render.quiet_zone & 0xFFFFFF)
+                      << 32;
+    }
+    return params;
+}
+
+uint64_t SymbolCache::hash_key(const SymbolKey& key, uint64_t params) {
+    return hash_bytes(key.payload.data(), key.payload.size(), mix(params));
+}
+
+SymbolCache::Shard& SymbolCache::shard_for(uint64_t hash) {
+    return *shards_[(hash >> 48) % shards_.size()];
+}
+
+std::shared_ptr<const CachedSymbol> SymbolCache::find(const SymbolKey& key) {
+    uint64_t params = pack_params(key);
+    uint64_t hash = hash_key(key, params);
+    Shard& shard = shard_for(hash);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(hash);
+    if (it == shard.index.end() || it->second->params != params ||
+        it->second->payload != key.payload) {
+        ++shard.misses;
+        return nullptr;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    ++shard.hits;
+    return it->second->symbol;
+}
+
+std::shared_ptr<const CachedSymbol> SymbolCache::insert(
+    const SymbolKey& key, const QRMatrix& matrix, int mask,
+    std::vector<uint8_t> image) {
+    auto symbol = std::make_shared<CachedSymbol>();
+    symbol->size = matrix.size();
+    symbol->mask = mask;
+    symbol->words.assign(matrix.data(), matrix.data() + matrix.word_count());
+    symbol->image = std::move(image);
+
+    uint64_t params = pack_params(key);
+    uint64_t hash = hash_key(key, params);
+    size_t cost = NODE_OVERHEAD + key.payload.size() +
+                  symbol->words.size() * sizeof(QRMatrix::Word) +
+                  symbol->image.size();
+    if (cost > shard_budget_) return symbol;  // не помещается в шард
+
+    Shard& shard = shard_for(hash);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(hash);
+    if (it != shard.index.end()) {
+        // Тот же ключ (или коллизия хэша) — запись заменяется
+        shard.bytes -= it->second->cost;
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+    }
+    shard.lru.push_front(
+        Node{hash, std::string(key.payload), params, cost, symbol});
+    shard.index.emplace(hash, shard.lru.begin());
+    shard.bytes += cost;
+    ++shard.insertions;
+    evict(shard);
+    return symbol;
+}
+
+void SymbolCache::evict(Shard& shard) {
+    while (shard.bytes > shard_budget_ && !shard.lru.empty()) {
+        Node& last = shard.lru.back();
+        shard.bytes -= last.cost;
+        shard.index.erase(last.hash);
+        shard.lru.pop_back();
+        ++shard.evictions;
+    }
+}
+
+std::shared_ptr<const CachedSymbol> SymbolCache::get_or_create(
+    const SymbolKey& key, ReedSolomon& rs, const QRCode& qr,
+    QRMatrix& matrix) {
+    if (auto symbol = find(key)) return symbol;
+    ReedSolomon::Code code = rs.encode(std::string(key.payload), key.level);
+    int mask = qr.generate(code.data(), code.size(), matrix, key.level,
+                           key.mask);
+    std::vector<uint8_t> image;
+    if (key.with_image) render_image(matrix, key.render, image);
+    return insert(key, matrix, mask, std::move(image));
+}
+
+SymbolCache::Stats SymbolCache::stats() const {
+    Stats total;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        total.hits += shard->hits;
+        total.misses += shard->misses;
+        total.insertions += shard->insertions;
+        total.evictions += shard->evictions;
+        total.entries += shard->lru.size();
+        total.bytes += shard->bytes;
+    }
+    return total;
+}
+
+void SymbolCache::clear() {
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->lru.clear();
+        shard->index.clear();
+        shard->bytes = 0;
+    }
+}